@@ -0,0 +1,404 @@
+// Based on the DEC/ANSI parser state machine: https://vt100.net/emu/dec_ansi_parser
+
+#include "types.h"
+#include "color.h"
+#include "ansi.h"
+
+// Parser states
+#define S_GROUND     0
+#define S_ESCAPE     1      // After ESC
+#define S_CSI        2      // After ESC[, taking parameters
+#define S_CSI_IGNORE 3      // A CSI we don't understand, until its end
+#define S_OSC        4      // ESC] operating system command, ignored
+#define S_UTF8       5      // Inside a multibyte UTF-8 character
+#define S_COUNT      6
+
+// Classes of characters
+#define C_CONTROL   0       // C0 controls, other than those below
+#define C_BEL       1
+#define C_ESC       2
+#define C_INTER     3       // 0x20-0x2f, intermediates
+#define C_DIGIT     4
+#define C_SEP       5       // ; and :
+#define C_PRIVATE   6       // < = > ?
+#define C_LBRACKET  7
+#define C_RBRACKET  8
+#define C_FINAL     9       // Everything else up to 0x7e
+#define C_DEL       10
+#define C_CONT      11      // 0x80-0xbf, UTF-8 continuation bytes
+#define C_LEAD      12      // 0xc2-0xf4, start a UTF-8 character
+#define C_HIGH      13      // Other bytes never seen in UTF-8
+#define C_COUNT     14
+
+// Actions
+#define A_NONE      0
+#define A_PRINT     1
+#define A_EXECUTE   2
+#define A_START     3       // Clear the parameters
+#define A_PARAM     4
+#define A_SEP       5
+#define A_PRIVATE   6
+#define A_CSI       7
+#define A_ESC       8
+#define A_LEAD      9
+#define A_CONT      10
+#define A_CUT       11      // A UTF-8 character cut short, the byte goes again
+
+#define T(action, next) (((action) << 4) | (next))
+
+static const uint8_t transitions[S_COUNT][C_COUNT] = {
+    // S_GROUND
+    { T(A_EXECUTE, S_GROUND), T(A_EXECUTE, S_GROUND), T(A_START, S_ESCAPE), T(A_PRINT, S_GROUND),
+      T(A_PRINT, S_GROUND), T(A_PRINT, S_GROUND), T(A_PRINT, S_GROUND), T(A_PRINT, S_GROUND),
+      T(A_PRINT, S_GROUND), T(A_PRINT, S_GROUND), T(A_NONE, S_GROUND), T(A_PRINT, S_GROUND),
+      T(A_LEAD, S_UTF8), T(A_PRINT, S_GROUND) },
+    // S_ESCAPE
+    { T(A_EXECUTE, S_ESCAPE), T(A_EXECUTE, S_ESCAPE), T(A_START, S_ESCAPE), T(A_NONE, S_ESCAPE),
+      T(A_ESC, S_GROUND), T(A_ESC, S_GROUND), T(A_ESC, S_GROUND), T(A_START, S_CSI),
+      T(A_NONE, S_OSC), T(A_ESC, S_GROUND), T(A_NONE, S_ESCAPE), T(A_NONE, S_GROUND),
+      T(A_NONE, S_GROUND), T(A_NONE, S_GROUND) },
+    // S_CSI
+    { T(A_EXECUTE, S_CSI), T(A_EXECUTE, S_CSI), T(A_START, S_ESCAPE), T(A_NONE, S_CSI_IGNORE),
+      T(A_PARAM, S_CSI), T(A_SEP, S_CSI), T(A_PRIVATE, S_CSI), T(A_CSI, S_GROUND),
+      T(A_CSI, S_GROUND), T(A_CSI, S_GROUND), T(A_NONE, S_CSI), T(A_NONE, S_GROUND),
+      T(A_NONE, S_GROUND), T(A_NONE, S_GROUND) },
+    // S_CSI_IGNORE
+    { T(A_EXECUTE, S_CSI_IGNORE), T(A_EXECUTE, S_CSI_IGNORE), T(A_START, S_ESCAPE), T(A_NONE, S_CSI_IGNORE),
+      T(A_NONE, S_CSI_IGNORE), T(A_NONE, S_CSI_IGNORE), T(A_NONE, S_CSI_IGNORE), T(A_NONE, S_GROUND),
+      T(A_NONE, S_GROUND), T(A_NONE, S_GROUND), T(A_NONE, S_CSI_IGNORE), T(A_NONE, S_GROUND),
+      T(A_NONE, S_GROUND), T(A_NONE, S_GROUND) },
+    // S_OSC, ends with BEL or ESC backslash
+    { T(A_NONE, S_OSC), T(A_NONE, S_GROUND), T(A_START, S_ESCAPE), T(A_NONE, S_OSC),
+      T(A_NONE, S_OSC), T(A_NONE, S_OSC), T(A_NONE, S_OSC), T(A_NONE, S_OSC),
+      T(A_NONE, S_OSC), T(A_NONE, S_OSC), T(A_NONE, S_OSC), T(A_NONE, S_OSC),
+      T(A_NONE, S_OSC), T(A_NONE, S_OSC) },
+    // S_UTF8, anything but a continuation cuts the character short
+    { T(A_CUT, S_GROUND), T(A_CUT, S_GROUND), T(A_CUT, S_GROUND), T(A_CUT, S_GROUND),
+      T(A_CUT, S_GROUND), T(A_CUT, S_GROUND), T(A_CUT, S_GROUND), T(A_CUT, S_GROUND),
+      T(A_CUT, S_GROUND), T(A_CUT, S_GROUND), T(A_CUT, S_GROUND), T(A_CONT, S_UTF8),
+      T(A_CUT, S_GROUND), T(A_CUT, S_GROUND) },
+};
+
+static uint8_t classes[256];
+static unsigned classes_ready = false;
+
+
+// The 16 standard colors, as xterm has them.
+static const uint8_t ansi_16[16][3] = {
+    {0x00, 0x00, 0x00}, {0xcd, 0x00, 0x00}, {0x00, 0xcd, 0x00}, {0xcd, 0xcd, 0x00},
+    {0x00, 0x00, 0xee}, {0xcd, 0x00, 0xcd}, {0x00, 0xcd, 0xcd}, {0xe5, 0xe5, 0xe5},
+    {0x7f, 0x7f, 0x7f}, {0xff, 0x00, 0x00}, {0x00, 0xff, 0x00}, {0xff, 0xff, 0x00},
+    {0x5c, 0x5c, 0xff}, {0xff, 0x00, 0xff}, {0x00, 0xff, 0xff}, {0xff, 0xff, 0xff}
+};
+
+// Slots of the 256 indexed colors, 0 until first used.
+static uint8_t indexed_slots[256];
+
+
+static void ansi_build_classes() {
+    unsigned ch;
+
+    for (ch = 0; ch < 256; ch++) {
+        if (ch == 0x07) {
+            classes[ch] = C_BEL;
+        } else if (ch == 0x1b) {
+            classes[ch] = C_ESC;
+        } else if (ch < 0x20) {
+            classes[ch] = C_CONTROL;
+        } else if (ch < 0x30) {
+            classes[ch] = C_INTER;
+        } else if (ch < 0x3a) {
+            classes[ch] = C_DIGIT;
+        } else if ((ch == ';') || (ch == ':')) {
+            classes[ch] = C_SEP;
+        } else if (ch < 0x40) {
+            classes[ch] = C_PRIVATE;
+        } else if (ch == '[') {
+            classes[ch] = C_LBRACKET;
+        } else if (ch == ']') {
+            classes[ch] = C_RBRACKET;
+        } else if (ch < 0x7f) {
+            classes[ch] = C_FINAL;
+        } else if (ch == 0x7f) {
+            classes[ch] = C_DEL;
+        } else if (ch < 0xc0) {
+            classes[ch] = C_CONT;
+        } else if ((ch >= 0xc2) && (ch <= 0xf4)) {
+            classes[ch] = C_LEAD;
+        } else {
+            classes[ch] = C_HIGH;
+        }
+    }
+
+    classes_ready = true;
+}
+
+
+void ansi_init(ansi_t *ansi) {
+    if (!classes_ready) {
+        ansi_build_classes();
+    }
+
+    memset(ansi, 0, sizeof(ansi_t));
+    ansi->state = S_GROUND;
+}
+
+
+unsigned ansi_feed(ansi_t *ansi, unsigned char ch) {
+    unsigned t = transitions[ansi->state][classes[ch]];
+    unsigned *p = NULL;
+
+    ansi->state = t & 0x0f;
+
+    switch (t >> 4) {
+    case A_PRINT:
+        ansi->code = (ch < 0x80) ? ch : 0xfffd;
+        return(ANSI_PRINT);
+
+    case A_LEAD:
+        ansi->pending = (ch >= 0xf0) ? 3 : (ch >= 0xe0) ? 2 : 1;
+        ansi->least = (ch >= 0xf0) ? 0x10000 : (ch >= 0xe0) ? 0x800 : 0x80;
+        ansi->code = ch & (0x3f >> ansi->pending);
+        break;
+
+    case A_CONT:
+        ansi->code = (ansi->code << 6) | (ch & 0x3f);
+        if (--ansi->pending) {
+            break;
+        }
+
+        // Overlong, a surrogate or past the end of Unicode
+        ansi->state = S_GROUND;
+        if ((ansi->code < ansi->least) || ((ansi->code >= 0xd800) && (ansi->code < 0xe000)) || (ansi->code > 0x10ffff)) {
+            ansi->code = 0xfffd;
+        }
+        return(ANSI_PRINT);
+
+    case A_CUT:
+        ansi->code = 0xfffd;
+        ansi->again = true;
+        return(ANSI_PRINT);
+
+    case A_EXECUTE:
+        return(ANSI_CONTROL);
+
+    case A_START:
+        memset(ansi->params, 0, sizeof(ansi->params));
+        ansi->param_count = 0;
+        ansi->private = 0;
+        break;
+
+    case A_PARAM:
+        if (ansi->param_count == 0) {
+            ansi->param_count = 1;
+        }
+        p = ansi->params + ansi->param_count - 1;
+        if (*p < 10000) {
+            *p = *p * 10 + (ch - '0');
+        }
+        break;
+
+    case A_SEP:
+        if (ansi->param_count == 0) {
+            ansi->param_count = 1;
+        }
+        if (ansi->param_count < ANSI_MAX_PARAMS) {
+            ansi->param_count++;
+        }
+        break;
+
+    case A_PRIVATE:
+        ansi->private = ch;
+        break;
+
+    case A_CSI:
+        ansi->final = ch;
+        return(ANSI_CSI);
+
+    case A_ESC:
+        ansi->final = ch;
+        return(ANSI_ESC);
+    }
+
+    return(ANSI_NONE);
+}
+
+
+unsigned ansi_idle(ansi_t *ansi) {
+    return(ansi->state == S_GROUND);
+}
+
+
+unsigned ansi_again(ansi_t *ansi) {
+    unsigned answer = ansi->again;
+
+    ansi->again = false;
+    return(answer);
+}
+
+
+// Is code in one of the sorted ranges?
+static unsigned ansi_in_ranges(const unsigned ranges[][2], unsigned count, unsigned code) {
+    unsigned low = 0;
+    unsigned high = count;
+    unsigned mid;
+
+    while (low < high) {
+        mid = (low + high) / 2;
+        if (code < ranges[mid][0]) {
+            high = mid;
+        } else if (code > ranges[mid][1]) {
+            low = mid + 1;
+        } else {
+            return(true);
+        }
+    }
+
+    return(false);
+}
+
+
+unsigned ansi_width(unsigned code) {
+    static const unsigned zero[][2] = {
+        {0x0300, 0x036f}, {0x0483, 0x0489}, {0x0591, 0x05bd}, {0x0610, 0x061a},
+        {0x064b, 0x065f}, {0x1ab0, 0x1aff}, {0x1dc0, 0x1dff}, {0x200b, 0x200f},
+        {0x202a, 0x202e}, {0x2060, 0x2064}, {0x20d0, 0x20ff}, {0xfe00, 0xfe0f},
+        {0xfe20, 0xfe2f}, {0xfeff, 0xfeff}, {0xe0100, 0xe01ef}
+    };
+    static const unsigned wide[][2] = {
+        {0x1100, 0x115f}, {0x231a, 0x231b}, {0x2329, 0x232a}, {0x23e9, 0x23ec},
+        {0x23f0, 0x23f0}, {0x23f3, 0x23f3}, {0x25fd, 0x25fe}, {0x2614, 0x2615},
+        {0x2648, 0x2653}, {0x267f, 0x267f}, {0x2693, 0x2693}, {0x26a1, 0x26a1},
+        {0x26aa, 0x26ab}, {0x26bd, 0x26be}, {0x26c4, 0x26c5}, {0x26ce, 0x26ce},
+        {0x26d4, 0x26d4}, {0x26ea, 0x26ea}, {0x26f2, 0x26f3}, {0x26f5, 0x26f5},
+        {0x26fa, 0x26fa}, {0x26fd, 0x26fd}, {0x2705, 0x2705}, {0x270a, 0x270b},
+        {0x2728, 0x2728}, {0x274c, 0x274c}, {0x274e, 0x274e}, {0x2753, 0x2755},
+        {0x2757, 0x2757}, {0x2795, 0x2797}, {0x27b0, 0x27b0}, {0x27bf, 0x27bf},
+        {0x2b1b, 0x2b1c}, {0x2b50, 0x2b50}, {0x2b55, 0x2b55}, {0x2e80, 0x303e},
+        {0x3041, 0x4dbf}, {0x4e00, 0xa4cf}, {0xa960, 0xa97f}, {0xac00, 0xd7a3},
+        {0xf900, 0xfaff}, {0xfe10, 0xfe19}, {0xfe30, 0xfe6f}, {0xff00, 0xff60},
+        {0xffe0, 0xffe6}, {0x16fe0, 0x16fe4}, {0x17000, 0x18cff}, {0x1b000, 0x1b2ff},
+        {0x1f004, 0x1f004}, {0x1f0cf, 0x1f0cf}, {0x1f18e, 0x1f18e}, {0x1f191, 0x1f19a},
+        {0x1f200, 0x1f251}, {0x1f300, 0x1f64f}, {0x1f680, 0x1f6ff}, {0x1f7e0, 0x1f7eb},
+        {0x1f90c, 0x1f9ff}, {0x1fa70, 0x1faff}, {0x20000, 0x2fffd}, {0x30000, 0x3fffd}
+    };
+
+    if (code < 0x300) {
+        return(1);
+    }
+
+    if (ansi_in_ranges(zero, sizeof(zero) / sizeof(zero[0]), code)) {
+        return(0);
+    }
+
+    return(ansi_in_ranges(wide, sizeof(wide) / sizeof(wide[0]), code) ? 2 : 1);
+}
+
+
+unsigned ansi_param(ansi_t *ansi, unsigned i, unsigned missing) {
+    if ((i >= ansi->param_count) || (ansi->params[i] == 0)) {
+        return(missing);
+    }
+
+    return(ansi->params[i]);
+}
+
+
+void ansi_default_pen(pen_t *pen) {
+    pen->fg = SLOT_FG;
+    pen->bg = SLOT_BG;
+    pen->attr = 0;
+    pen->code = 0;
+}
+
+
+static unsigned ansi_rgb_slot(unsigned r, unsigned g, unsigned b) {
+    return(color_slot(color_rgb_to_id(r, g, b)));
+}
+
+
+// One of the 256 colors: the 16 standard, a 6x6x6 cube, then 24 grays.
+static unsigned ansi_indexed_slot(unsigned n) {
+    static const uint8_t levels[6] = {0x00, 0x5f, 0x87, 0xaf, 0xd7, 0xff};
+    unsigned cube, gray;
+
+    n &= 0xff;
+    cube = n - 16;
+    if (indexed_slots[n] == 0) {
+        if (n < 16) {
+            indexed_slots[n] = ansi_rgb_slot(ansi_16[n][0], ansi_16[n][1], ansi_16[n][2]);
+        } else if (n < 232) {
+            indexed_slots[n] = ansi_rgb_slot(levels[cube / 36], levels[(cube / 6) % 6], levels[cube % 6]);
+        } else {
+            gray = 8 + (n - 232) * 10;
+            indexed_slots[n] = ansi_rgb_slot(gray, gray, gray);
+        }
+    }
+
+    return(indexed_slots[n]);
+}
+
+
+// 38 and 48 are followed by 5;n or 2;r;g;b.  Returns the parameters used.
+static unsigned ansi_extended_color(ansi_t *ansi, unsigned i, uint8_t *slot) {
+    unsigned *p = ansi->params + i;
+    unsigned left = ansi->param_count - i;
+
+    if ((left >= 3) && (p[1] == 5)) {
+        *slot = ansi_indexed_slot(p[2]);
+        return(2);
+    }
+
+    if ((left >= 5) && (p[1] == 2)) {
+        *slot = ansi_rgb_slot(p[2] & 0xff, p[3] & 0xff, p[4] & 0xff);
+        return(4);
+    }
+
+    return(left - 1);       // Can't make sense of the rest
+}
+
+
+void ansi_sgr(ansi_t *ansi, pen_t *pen) {
+    unsigned i, p;
+
+    if (ansi->param_count == 0) {
+        ansi_default_pen(pen);
+        return;
+    }
+
+    for (i = 0; i < ansi->param_count; i++) {
+        p = ansi->params[i];
+
+        if (p == 0) {
+            ansi_default_pen(pen);
+        } else if (p == 1) {
+            pen->attr |= ATTR_BOLD;
+        } else if (p == 4) {
+            pen->attr |= ATTR_UNDERLINE;
+        } else if (p == 7) {
+            pen->attr |= ATTR_INVERSE;
+        } else if (p == 22) {
+            pen->attr &= ~ATTR_BOLD;
+        } else if (p == 24) {
+            pen->attr &= ~ATTR_UNDERLINE;
+        } else if (p == 27) {
+            pen->attr &= ~ATTR_INVERSE;
+        } else if ((p >= 30) && (p <= 37)) {
+            pen->fg = ansi_indexed_slot(p - 30);
+        } else if (p == 38) {
+            i += ansi_extended_color(ansi, i, &pen->fg);
+        } else if (p == 39) {
+            pen->fg = SLOT_FG;
+        } else if ((p >= 40) && (p <= 47)) {
+            pen->bg = ansi_indexed_slot(p - 40);
+        } else if (p == 48) {
+            i += ansi_extended_color(ansi, i, &pen->bg);
+        } else if (p == 49) {
+            pen->bg = SLOT_BG;
+        } else if ((p >= 90) && (p <= 97)) {
+            pen->fg = ansi_indexed_slot(p - 90 + 8);
+        } else if ((p >= 100) && (p <= 107)) {
+            pen->bg = ansi_indexed_slot(p - 100 + 8);
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef ANSI_H
+#define ANSI_H
+
+#include "types.h"
+
+// Escape sequences in the input, fed in one byte at a time.  Text is
+// UTF-8, malformed bytes come out as U+FFFD.
+
+
+typedef struct {        // What characters are drawn with
+    uint8_t fg;         // Color slots
+    uint8_t bg;
+    uint8_t attr;
+    unsigned code;      // The character when it's beyond ASCII, or 0
+} pen_t;
+
+#define ATTR_BOLD      1
+#define ATTR_UNDERLINE 2
+#define ATTR_INVERSE   4
+
+
+#define ANSI_MAX_PARAMS 16
+
+typedef struct {
+    unsigned state;
+    unsigned params[ANSI_MAX_PARAMS];
+    unsigned param_count;
+    unsigned char private;      // i.e. the '?' of ESC[?25h, or 0
+    unsigned char final;        // Last character of a sequence
+    unsigned code;              // Character to show, UTF-8 decoded
+    unsigned pending;           // UTF-8 continuation bytes still to come
+    unsigned least;             // Smallest code point for its length
+    unsigned again;             // The last byte has to be fed again
+} ansi_t;
+
+
+// What ansi_feed() found
+#define ANSI_NONE    0      // Part of a sequence, nothing to do yet
+#define ANSI_PRINT   1      // A character to show, see code
+#define ANSI_CONTROL 2      // A control character, i.e. \n
+#define ANSI_CSI     3      // ESC[ params final, see params and final
+#define ANSI_ESC     4      // ESC and a single final character
+
+
+void ansi_init(ansi_t *ansi);
+
+unsigned ansi_feed(ansi_t *ansi, unsigned char ch);
+
+// True when not in the middle of a sequence.
+unsigned ansi_idle(ansi_t *ansi);
+
+// A byte that cuts a UTF-8 character short gives its U+FFFD first,
+// then this is true once and the same byte has to be fed again.
+unsigned ansi_again(ansi_t *ansi);
+
+// Columns character code takes: 2 for East Asian wide ones, 0 for
+// combining marks and other zero width characters, otherwise 1.
+unsigned ansi_width(unsigned code);
+
+// Parameter i of a sequence, or missing when it isn't given or is 0.
+unsigned ansi_param(ansi_t *ansi, unsigned i, unsigned missing);
+
+// The pen for plain text, in the text and background slots.
+void ansi_default_pen(pen_t *pen);
+
+// Apply a complete ESC[...m (Select Graphic Rendition) to the pen.
+void ansi_sgr(ansi_t *ansi, pen_t *pen);
+
+#endif
@@ -8,53 +8,107 @@
 struct image_t {
     unsigned bit_width;
     unsigned bit_height;
-    uint8_t *data;
+    bmp_row_fn row_fn;
+    void *context;
+    uint8_t *row;           // Where row_fn puts a row
+    uint8_t *colors;        // Optional, the slots that may be used
+    char *written;          // The last BMP file written, and the slots
+    uint8_t slots[256];     // in its color table, for a new theme.
+    unsigned slot_count;
+    void *owned;            // Freed along with the image
 };
 
+// Slots of the same color share a color table entry.
+static unsigned bmp_share = true;
 
-void bmp_set_bit(struct image_t *bmp, unsigned x, unsigned y, unsigned color) {
-    uint8_t *dp = NULL;
 
-    dp = bmp->data + x + (y * bmp->bit_width);
-    *dp = color;
+struct image_t *bmp_new_rows(unsigned width, unsigned height, bmp_row_fn row_fn, void *context) {
+    struct image_t *answer = NULL;
+
+    answer = (struct image_t *) malloc(sizeof(struct image_t));
+    assert(answer);
+
+    answer->bit_width = width;
+    answer->bit_height = height;
+    answer->row_fn = row_fn;
+    answer->context = context;
+    answer->colors = NULL;
+    answer->written = NULL;
+    answer->slot_count = 0;
+    answer->owned = NULL;
+
+    // Only ever one row at a time.
+    answer->row = (uint8_t *) malloc(width);
+    assert(answer->row);
+
+    return(answer);
 }
 
 
-void bmp_get_bit(struct image_t *bmp, unsigned x, unsigned y, unsigned *color) {
-    uint8_t *dp = NULL;
+typedef struct {
+    struct image_t *source;
+    unsigned factor;
+} scaled_t;
+
+
+static void bmp_scaled_row(void *context, unsigned y, uint8_t *row) {
+    scaled_t *scaled = (scaled_t *) context;
+    unsigned factor = scaled->factor;
+    unsigned width = bmp_width(scaled->source) / factor;
+    unsigned height = bmp_height(scaled->source);
+    unsigned i, j, x;
+    uint8_t *s = NULL;
+
+    memset(row, SLOT_BG, width);
+
+    for (i = 0; (i < factor) && (y * factor + i < height); i++) {
+        s = bmp_row(scaled->source, y * factor + i);
 
-    dp = bmp->data + x + (y * bmp->bit_width);
-    *color = *dp;
+        for (x = 0; x < width; x++) {
+            for (j = 0; (row[x] == SLOT_BG) && (j < factor); j++) {
+                row[x] = s[x * factor + j];
+            }
+        }
+    }
 }
 
 
-// Caller will ask for a virtual screen, of width x height in characters
-// This code will handle the padding, etc.
-struct image_t *bmp_new(unsigned width, unsigned height) {
-    unsigned amount, color;
+struct image_t *bmp_new_scaled(struct image_t *source, unsigned factor) {
     struct image_t *answer = NULL;
-    uint8_t *p;
+    scaled_t *scaled = NULL;
 
-    answer = (struct image_t *) malloc(sizeof(struct image_t));
-    assert(answer);
+    scaled = (scaled_t *) malloc(sizeof(scaled_t));
+    assert(scaled);
+    scaled->source = source;
+    scaled->factor = factor;
 
-    answer->bit_width = width;
-    answer->bit_height = height;
+    answer = bmp_new_rows(source->bit_width / factor, source->bit_height / factor, bmp_scaled_row, scaled);
+    answer->owned = scaled;
+    return(answer);
+}
 
-    amount = answer->bit_width * answer->bit_height;
 
-    answer->data = (uint8_t *) malloc(amount);
-    assert(answer->data);
+void bmp_share_colors(unsigned share) {
+    bmp_share = share;
+}
 
-    p = answer->data;
 
-    // Set background
-    color = color_bg();
-    while (amount--) {
-        *(p++) = color;
+void bmp_set_colors(struct image_t *bmp, uint8_t *used) {
+    if (bmp->colors == NULL) {
+        bmp->colors = (uint8_t *) malloc(256);
+        assert(bmp->colors);
     }
 
-    return(answer);
+    memcpy(bmp->colors, used, 256);
+}
+
+
+void bmp_free(struct image_t *bmp) {
+    free(bmp->row);  bmp->row = NULL;
+    free(bmp->colors);  bmp->colors = NULL;
+    free(bmp->written);  bmp->written = NULL;
+    free(bmp->owned);  bmp->owned = NULL;
+    free(bmp);
 }
 
 
@@ -72,27 +126,110 @@ static void writebits(FILE *fp, uint8_t *p, unsigned remain) {
 }
 
 
-// Generate a run length compresion of the BMP file.  Don't need
-// the optimal compression here, jsut something pretty good. 
-// Could use the existing image for this, but there's no need.
-static uint8_t *bmp_make_compressed(struct image_t *bmp, unsigned *compressed_len) {
-    unsigned rows, amount;
-    uint8_t *start = NULL;
+// Number the slots in use into a compact palette: map[] goes from a
+// slot to the palette index, ids[] from the palette index back to a
+// slot.  Slots showing the same color share an entry, unless the theme
+// may change afterwards.
+static unsigned bmp_number_slots(unsigned *used, uint8_t *map, uint8_t *ids) {
+    unsigned rgb[256];
+    unsigned n = 0;
+    unsigned slot, i, r, g, b;
+
+    for (slot = 0; slot < 256; slot++) {
+        if (!used[slot]) {
+            continue;
+        }
+
+        color_slot_to_rgb(slot, &r, &g, &b);
+        rgb[n] = (r << 16) | (g << 8) | b;
+        for (i = 0; (i < n) && !(bmp_share && (rgb[i] == rgb[n])); i++)
+            ;
+
+        map[slot] = i;
+        if (i == n) {
+            ids[n++] = slot;
+        }
+    }
+
+    return(n);
+}
+
+
+// Find the colors actually used, typically only 3 or 4 of them, and
+// number them.  The number of runs is a good estimate of the RLE size.
+static unsigned bmp_count_colors(struct image_t *bmp, uint8_t *map, uint8_t *ids, size_t *runs) {
+    unsigned used[256];
+    unsigned n, y;
     uint8_t *s = NULL;
-    uint8_t *d = NULL;
-    uint8_t *max = NULL;
-    unsigned color = 0;
-    unsigned ct = 0;
+    uint8_t *end = NULL;
+    uint8_t last;
+
+    memset(used, 0, sizeof(used));
+    *runs = 0;
+
+    // When told which colors to expect, only scan if it might
+    // turn out to be a two color image.
+    n = 0;
+    if (bmp->colors) {
+        for (y = 0; y < 256; y++) {
+            used[y] = bmp->colors[y];
+        }
+        n = bmp_number_slots(used, map, ids);
+    }
 
-    // Compression will be done so that it will take less room. 
-    // But no need to be cute here by taking over the same
-    // area as the current image.
-    amount = bmp->bit_width * bmp->bit_height;
-    start = (uint8_t *) malloc(amount);
-    assert(start);
+    for (y = 0; (n <= 2) && (y < bmp->bit_height); y++) {
+        s = bmp_row(bmp, y);
+        end = s + bmp->bit_width;
+
+        // Skip over runs, no need to mark the same color over and over.
+        while (s < end) {
+            last = *(s++);
+            used[last] = true;
+            while ((s < end) && (*s == last)) {
+                s++;
+            }
+            *runs += 1;
+        }
+    }
+
+    return(bmp_number_slots(used, map, ids));
+}
 
-    // Will test as we go
-    max = start + amount;
+
+// With just two colors, plain 1 bit per pixel, padded to 32 bits.
+static uint8_t *bmp_packed1_row(uint8_t *d, uint8_t *s, unsigned width, uint8_t *map) {
+    unsigned x;
+    uint8_t byte = 0;
+
+    for (x = 0; x < width; x++) {
+        byte = (byte << 1) | map[*(s++)];
+        if ((x & 7) == 7) {
+            *(d++) = byte;
+            byte = 0;
+        }
+    }
+
+    if (x & 7) {
+        *(d++) = byte << (8 - (x & 7));
+        x = (x + 7) & ~7;
+    }
+
+    // Pad out to a 4 byte boundary
+    while (x & 31) {
+        *(d++) = 0;
+        x += 8;
+    }
+
+    return(d);
+}
+
+
+// Generate a run length compresion of a BMP row, 8 bits per pixel.
+// Don't need the optimal compression here, just something pretty good.
+// Returns the end of the encoded data.
+static uint8_t *bmp_rle8_row(uint8_t *d, uint8_t *s, unsigned width, uint8_t *map) {
+    uint8_t color = 0;
+    unsigned ct = 0;
 
     // In general:
     // 1st pass per line: (expect lots of repeated backgroun)
@@ -105,66 +242,88 @@ static uint8_t *bmp_make_compressed(struct image_t *bmp, unsigned *compressed_le
     // 00 00 end of line
     // 00 01 end of bitmap
 
-    d = start;
-    for (rows = 0; rows < bmp->bit_height; rows++) {
-        // BMP is upsidedown
-        s = bmp->data + (bmp->bit_height - rows - 1) * bmp->bit_width;
-
-        ct = 0;     // And color == undefined
-        amount = bmp->bit_width;
-        while (amount-- > 0) {
-            if (ct == 255) {
-                // Maximum for this run, so store it.
-                *(d++) = ct;
-                *(d++) = color;
-                assert(d < max);
-
-                ct = 0;     // And color == undefined
-            }
-
-            if (ct == 0) {
-                // Get the color and start counting
-                color = *(s++);
-                ct = 1;
-            } else {
-                // If same color, increment count, won't ever be > 255
-                if (color == *s) {
-                    ct++;
-                } else {
-                    *(d++) = ct;
-                    *(d++) = color;
-                    assert(d < max);
-
-                    // New entry
-                    ct = 1;
-                    color = *s;
-                }
+    while (width > 0) {
+        color = *(s++);
+        ct = 1;
+        width--;
 
-                s++;
-            }
+        // Count up the same color, maximum of 255 for a run.
+        while ((width > 0) && (ct < 255) && (map[*s] == map[color])) {
+            ct++;
+            s++;
+            width--;
         }
 
-        // Leftover
-        if (ct) {
-            *(d++) = ct;
-            *(d++) = color;
-            assert(d < max);
+        *(d++) = ct;
+        *(d++) = map[color];
+    }
+
+    // End of line
+    *(d++) = 0;
+    *(d++) = 0;
+
+    return(d);
+}
+
+
+// Same, but with 4 bits per pixel.  A run in RLE4 alternates between the
+// two nibbles of the color byte, so a run can be a single color or a
+// pattern of two (i.e. a thin stroke of a glyph and the background).
+static uint8_t *bmp_rle4_row(uint8_t *d, uint8_t *s, unsigned width, uint8_t *map) {
+    uint8_t first, second;
+    unsigned ct = 0;
+
+    while (width > 0) {
+        first = map[*s];
+        second = (width > 1) ? map[*(s + 1)] : first;
+
+        // Extend while the pixels keep alternating first/second.
+        ct = 1;
+        while ((ct < width) && (ct < 255) && (map[s[ct]] == ((ct & 1) ? second : first))) {
+            ct++;
         }
 
-        // End of line
-        *(d++) = 0;
-        *(d++) = 0;
-        assert(d < max);
+        *(d++) = ct;
+        *(d++) = (first << 4) | second;
+
+        s += ct;
+        width -= ct;
     }
 
-    // End of bitmap
+    // End of line
+    *(d++) = 0;
     *(d++) = 0;
-    *(d++) = 1;
-    assert(d < max);
 
-    // Figure out the length used, note that we may use less.
-    *compressed_len = d - start;
-    return(start);
+    return(d);
+}
+
+
+// Write out the headers a byte at a time to avoid endian issues.
+static void bmp_write_headers(FILE *outfile, unsigned *headers, unsigned count) {
+    unsigned n;
+
+    fprintf(outfile, "BM");
+
+    for (n = 0; n < count; n++) {
+        fprintf(outfile, "%c", headers[n] & 0x000000FF);
+        fprintf(outfile, "%c", (headers[n] & 0x0000FF00) >> 8);
+        fprintf(outfile, "%c", (headers[n] & 0x00FF0000) >> 16);
+        fprintf(outfile, "%c", (headers[n] & 0xFF000000) >> 24);
+    }
+}
+
+
+// The color table, with the current color of each slot used.
+static void bmp_write_palette(FILE *outfile, uint8_t *slots, unsigned count) {
+    unsigned n, r, g, b;
+
+    for (n = 0; n < count; n++) {
+        color_slot_to_rgb(slots[n], &r, &g, &b);
+        fprintf(outfile, "%c", b);
+        fprintf(outfile, "%c", g);
+        fprintf(outfile, "%c", r);
+        fprintf(outfile, "%c", 0);
+    }
 }
 
 
@@ -174,121 +333,138 @@ void bmp_write_image(char *filename, struct image_t *bmp) {
     unsigned width = bmp->bit_width;
     unsigned height = bmp->bit_height;
     unsigned int paddedsize;
-    int n;
-    unsigned r, g, b;
+    unsigned n, colors, bits;
+    size_t runs;
+    uint8_t map[256];
+    uint8_t ids[256];
     uint8_t *compressed = NULL;
-    unsigned compressed_len = 0;
+    uint8_t *end = NULL;
+    size_t compressed_len = 0;
+
+    // Only a handful of colors are normally in use, in which case
+    // the 4 bit encoding is half the size and has a tiny color table.
+    // With two colors, the uncompressed 1 bit image may be smaller still
+    // since glyph rows break up the runs.  A run costs two bytes.
+    colors = bmp_count_colors(bmp, map, ids, &runs);
+    bits = (colors <= 16) ? 4 : 8;
+    if ((colors <= 2) && ((size_t) ((width + 31) / 32) * 4 * height < 2 * (runs + height))) {
+        bits = 1;
+    }
 
-    compressed = bmp_make_compressed(bmp, &compressed_len);
+    // One row at a time, worst case is a run for every pixel.
+    compressed = (uint8_t *) malloc(2 * (size_t) width + 4);
     assert(compressed);
 
     // Header + color table (RGB and Alpha)
-    paddedsize = 54 + (256 * 4);
+    paddedsize = 54 + (colors * 4);
 
-    headers[0]  = paddedsize + compressed_len;  // bfSize (whole file size)
+    headers[0]  = paddedsize;                   // bfSize (whole file size), fixed up at the end
     headers[1]  = 0;                            // bfReserved (both)
     headers[2]  = paddedsize;                   // bfOffbits
     headers[3]  = 40;                           // biSize
     headers[4]  = width;                        // biWidth
     headers[5]  = height;                       // biHeight
-    headers[6]  = 0x00080001;                   // biPlanes and biBitCounts are fixed
-    headers[7]  = 1;                            // biCompression -  8 bit RLE
-    headers[8]  = compressed_len;               // biSizeImage
+    headers[6]  = (bits << 16) | 1;             // biPlanes and biBitCounts
+    headers[7]  = (bits == 1) ? 0 : (bits == 4) ? 2 : 1;    // biCompression - none, 4 or 8 bit RLE
+    headers[8]  = 0;                            // biSizeImage, fixed up at the end
     headers[9]  = 0;                            // biXPelsPerMeter
     headers[10] = 0;                            // biYPelsPerMeter
-    headers[11] = 256;                          // biClrUsed
-    headers[12] = 256;                          // biClrImportant
+    headers[11] = colors;                       // biClrUsed
+    headers[12] = colors;                       // biClrImportant
 
     outfile = fopen(filename, "wb");
+    assert(outfile);
 
-    //
-    // Headers begin...
-    // Write out 1 character at a time to avoid endian issues.
-    //
+    bmp_write_headers(outfile, headers, sizeof(headers) / sizeof(headers[0]));
 
-    fprintf(outfile, "BM");
+    // Now do the color table, only the colors used
+    bmp_write_palette(outfile, ids, colors);
 
-    for (n = 0; n < (sizeof(headers) / sizeof(headers[0])); n++) {
-        fprintf(outfile, "%c", headers[n] & 0x000000FF);
-        fprintf(outfile, "%c", (headers[n] & 0x0000FF00) >> 8);
-        fprintf(outfile, "%c", (headers[n] & 0x00FF0000) >> 16);
-        fprintf(outfile, "%c", (headers[n] & 0xFF000000) >> 24);
-    }
+    // And blather out the rows, BMP is upsidedown
+    for (n = 0; n < height; n++) {
+        if (bits == 1) {
+            end = bmp_packed1_row(compressed, bmp_row(bmp, height - n - 1), width, map);
+        } else if (bits == 4) {
+            end = bmp_rle4_row(compressed, bmp_row(bmp, height - n - 1), width, map);
+        } else {
+            end = bmp_rle8_row(compressed, bmp_row(bmp, height - n - 1), width, map);
+        }
 
-    // Now do the color table
-    for (n = 0; n < 256; n++) {
-        color_to_rgb(n, &r, &g, &b);
-        fprintf(outfile, "%c", b);
-        fprintf(outfile, "%c", g);
-        fprintf(outfile, "%c", r);
-        fprintf(outfile, "%c", 0);
+        // End of bitmap
+        if ((bits != 1) && (n == height - 1)) {
+            *(end++) = 0;
+            *(end++) = 1;
+        }
+
+        writebits(outfile, compressed, end - compressed);
+        compressed_len += end - compressed;
     }
 
-    // And blather out the compressed table
-    writebits(outfile, compressed, compressed_len);
+    // Now that the size is known, go back and fix up the headers.
+    if (paddedsize + compressed_len > 0xffffffffu) {
+        fprintf(stderr, "Image is too large for a BMP file\n");
+        exit(EXIT_FAILURE);
+    }
+    headers[0] = paddedsize + compressed_len;
+    headers[8] = compressed_len;
+    fseek(outfile, 0, SEEK_SET);
+    bmp_write_headers(outfile, headers, sizeof(headers) / sizeof(headers[0]));
 
     fclose(outfile);
     free(compressed);  compressed = NULL;
+
+    // Remember enough to write it again with other colors.
+    free(bmp->written);
+    bmp->written = strdup(filename);
+    assert(bmp->written);
+    memcpy(bmp->slots, ids, colors);
+    bmp->slot_count = colors;
     return;
 }
 
 
-void bmp_draw_horiz_line(struct image_t *bmp, unsigned left, unsigned right, unsigned y, unsigned color) {
-    assert(left <= right);
+void bmp_write_theme(char *filename, struct image_t *bmp) {
+    FILE *infile = NULL;
+    FILE *outfile = NULL;
+    uint8_t buffer[4096];
+    size_t amount;
 
-    while (left <= right) {
-        bmp_set_bit(bmp, left++, y, color);
-    }
-}
+    assert(bmp->written);
 
+    infile = fopen(bmp->written, "rb");
+    assert(infile);
+    outfile = fopen(filename, "wb");
+    assert(outfile);
 
-void bmp_draw_vert_line(struct image_t *bmp, unsigned top, unsigned bottom, unsigned x, unsigned color) {
-    assert(top <= bottom);
+    // The headers don't change, the color table is redone and 
+    // the pixels are copied over as they are.
+    amount = fread(buffer, 1, 54 + bmp->slot_count * 4, infile);
+    assert(amount == 54 + bmp->slot_count * 4);
+    writebits(outfile, buffer, 54);
+    bmp_write_palette(outfile, bmp->slots, bmp->slot_count);
 
-    while (top <= bottom) {
-        bmp_set_bit(bmp, x, top++, color);
+    while ((amount = fread(buffer, 1, sizeof(buffer), infile)) > 0) {
+        writebits(outfile, buffer, amount);
     }
-}
-
 
+    fclose(infile);
+    fclose(outfile);
+}
 
-void bmp_draw_box(struct image_t *bmp, unsigned top, unsigned left, unsigned right, unsigned bottom, unsigned color, unsigned thickness) {
-    while (thickness-- != 0) {
-        bmp_draw_horiz_line(bmp, left, right, top, color);
-        bmp_draw_horiz_line(bmp, left, right, bottom, color);
-        bmp_draw_vert_line(bmp, top, bottom, left, color);
-        bmp_draw_vert_line(bmp, top, bottom, right, color);
 
-        left++;
-        right--;
-        top++;
-        bottom--;
-    }
+unsigned bmp_width(struct image_t *bmp) {
+    return(bmp->bit_width);
 }
 
 
-void bmp_move_up(struct image_t *bmp, unsigned dest_row, unsigned src_row, unsigned total_rows) {
-    uint8_t *dp = NULL;
-    uint8_t *sp = NULL;
-
-    dp = bmp->data + dest_row * bmp->bit_width;
-    sp = bmp->data + src_row * bmp->bit_width;
-    
-    // Copy line sp into dp until sp goes off the end.
-    while (total_rows-- < bmp->bit_height) {
-        memcpy(dp, sp, bmp->bit_width);
-        dp += bmp->bit_width;
-        sp += bmp->bit_width;
-    }
+unsigned bmp_height(struct image_t *bmp) {
+    return(bmp->bit_height);
 }
 
 
-// Shrink the BMP image by removing the rows at the bottom
-void bmp_shrink_height(struct image_t *bmp, unsigned new_height) {
-    // Shouldn't happen.
-    assert(bmp->bit_height >= new_height);
+uint8_t *bmp_row(struct image_t *bmp, unsigned y) {
+    assert(y < bmp->bit_height);
 
-    // Just change the height, don't need to reallocate the screen.
-    bmp->bit_height = new_height;
+    bmp->row_fn(bmp->context, y, bmp->row);
+    return(bmp->row);
 }
-
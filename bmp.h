@@ -7,34 +7,48 @@
 typedef struct image_t bmp_dummy;
 
 
-void bmp_set_bit(struct image_t *bmp, unsigned x, unsigned y, unsigned color);
+// Rather than storing the pixels, an image may produce each row on demand.
+// The function fills in row y (top row is 0) with width color slots.
+typedef void (*bmp_row_fn)(void *context, unsigned y, uint8_t *row);
 
+struct image_t *bmp_new_rows(unsigned width, unsigned height, bmp_row_fn row_fn, void *context);
 
-void bmp_get_bit(struct image_t *bmp, unsigned x, unsigned y, unsigned *color);
 
+// An image smaller by a whole factor.  Each pixel is the first color
+// other than the background in its factor x factor block, so thin lines
+// of text don't vanish.  The source must stay around.
+struct image_t *bmp_new_scaled(struct image_t *source, unsigned factor);
 
-// Caller will ask for a virtual screen, of width x height in characters
-// This code will handle the padding, etc.
-struct image_t *bmp_new(unsigned width, unsigned height);
 
+// The caller knows which slots may show up (used[slot] is true), which
+// saves scanning the image for them.  It's fine to list extra slots.
+void bmp_set_colors(struct image_t *bmp, uint8_t *used);
 
-void bmp_write_image(char *filename, struct image_t *bmp);
 
-void bmp_draw_horiz_line(struct image_t *bmp, unsigned left, unsigned right, unsigned y, unsigned color);
+// Slots that are the same color, i.e. the background and the border,
+// share an entry in the color table unless told otherwise.  Turn it off
+// when bmp_write_theme() is going to give the slots other colors.
+void bmp_share_colors(unsigned share);
+
 
-void bmp_draw_vert_line(struct image_t *bmp, unsigned top, unsigned bottom, unsigned x, unsigned color);
+void bmp_free(struct image_t *bmp);
 
 
-// For screen drawing a new line of text, shift the image up by amount bits.
-// Replaced bits will be background color.
-void bmp_move_up(struct image_t *bmp, unsigned dest_row, unsigned src_row, unsigned total_rows);
+void bmp_write_image(char *filename, struct image_t *bmp);
+
 
+// Write the last BMP written for this image again under a new name,
+// with the color table redone for the current color of each slot.
+// The pixel data is copied as is, so it's cheap to change the theme.
+void bmp_write_theme(char *filename, struct image_t *bmp);
 
-// Thickness and relative placement are fixed.
-void bmp_draw_box(struct image_t *bmp, unsigned top, unsigned left, unsigned right, unsigned bottom, unsigned color, unsigned thickness);
+// Size of the image in pixels
+unsigned bmp_width(struct image_t *bmp);
+unsigned bmp_height(struct image_t *bmp);
 
-// Shrink the BMP imag
-void bmp_shrink_height(struct image_t *bmp, unsigned new_height);
+// Color slots for the pixel row y, top row is 0.  Used by the other encoders.
+// The row is only good until the next call.
+uint8_t *bmp_row(struct image_t *bmp, unsigned y);
 
 
 #endif
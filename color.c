@@ -14,8 +14,135 @@ color_t colors[] = {
 };
 
 
-static unsigned color_background = 1;
-static unsigned color_foreground = 0;
+// Slot to color id, the first few follow the user's choices.
+static uint8_t slots[256] = {1, 0, 0, 0};
+static unsigned slot_count = SLOT_FIXED;
+
+
+/*
+ * The palette holds every distinct color in use, the id of a color is its
+ * index here and that's what is stored in the image.  The named colors
+ * come first so their ids never change.  A hash on the RGB value finds an
+ * existing entry.  Once all 256 entries are taken, a color maps to the 
+ * nearest one already in the palette, using a lookup table on the top 5
+ * bits of each of R, G and B.
+ */
+
+#define PALETTE_SIZE 256
+#define HASH_SIZE    512        // Power of 2, and at most half full
+#define LUT_BITS     5
+
+static color_t palette[PALETTE_SIZE];
+static unsigned palette_count = 0;
+static short palette_hash[HASH_SIZE];      // Index + 1, 0 is empty
+static uint8_t *palette_lut = NULL;
+
+
+static unsigned color_hash(unsigned rgb) {
+    return(((rgb * 2654435761u) >> 16) & (HASH_SIZE - 1));
+}
+
+
+// Closest entry by the squared distance of R, G and B.
+static unsigned color_nearest(unsigned r, unsigned g, unsigned b) {
+    unsigned i, best = 0;
+    unsigned distance, best_distance = ~0u;
+    int dr, dg, db;
+
+    for (i = 0; i < palette_count; i++) {
+        dr = (int) palette[i].r - (int) r;
+        dg = (int) palette[i].g - (int) g;
+        db = (int) palette[i].b - (int) b;
+        distance = dr * dr + dg * dg + db * db;
+
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = i;
+        }
+    }
+
+    return(best);
+}
+
+
+// The palette is full, so it won't change anymore.  Work out
+// the nearest color once for each cell of the RGB cube.
+static void color_build_lut() {
+    unsigned size = 1 << LUT_BITS;
+    unsigned half = 1 << (7 - LUT_BITS);
+    unsigned r, g, b;
+    uint8_t *d = NULL;
+
+    palette_lut = (uint8_t *) malloc(size * size * size);
+    assert(palette_lut);
+
+    d = palette_lut;
+    for (r = 0; r < size; r++) {
+        for (g = 0; g < size; g++) {
+            for (b = 0; b < size; b++) {
+                *(d++) = color_nearest((r << (8 - LUT_BITS)) + half, (g << (8 - LUT_BITS)) + half, (b << (8 - LUT_BITS)) + half);
+            }
+        }
+    }
+}
+
+
+static unsigned color_add(char *name, unsigned r, unsigned g, unsigned b) {
+    unsigned rgb = (r << 16) | (g << 8) | b;
+    unsigned h = color_hash(rgb);
+
+    while (palette_hash[h] != 0) {
+        h = (h + 1) & (HASH_SIZE - 1);
+    }
+
+    palette[palette_count].id = palette_count;
+    palette[palette_count].name = name;
+    palette[palette_count].r = r;
+    palette[palette_count].g = g;
+    palette[palette_count].b = b;
+    palette_hash[h] = palette_count + 1;
+
+    return(palette_count++);
+}
+
+
+// The named colors always take the first ids.
+void color_init() {
+    unsigned x;
+
+    for (x = 0; x < (sizeof(colors) / sizeof(colors[0])); x++) {
+        color_add(colors[x].name, colors[x].r, colors[x].g, colors[x].b);
+    }
+}
+
+
+unsigned color_rgb_to_id(unsigned r, unsigned g, unsigned b) {
+    unsigned rgb = ((r & 0xff) << 16) | ((g & 0xff) << 8) | (b & 0xff);
+    unsigned h = color_hash(rgb);
+    color_t *p = NULL;
+
+    while (palette_hash[h] != 0) {
+        p = palette + palette_hash[h] - 1;
+        if (((p->r << 16) | (p->g << 8) | p->b) == rgb) {
+            return(p->id);
+        }
+        h = (h + 1) & (HASH_SIZE - 1);
+    }
+
+    if (palette_count < PALETTE_SIZE) {
+        return(color_add(NULL, r & 0xff, g & 0xff, b & 0xff));
+    }
+
+    // Out of room, use the closest color instead.
+    if (palette_lut == NULL) {
+        color_build_lut();
+    }
+
+    r = (r & 0xff) >> (8 - LUT_BITS);
+    g = (g & 0xff) >> (8 - LUT_BITS);
+    b = (b & 0xff) >> (8 - LUT_BITS);
+    return(palette_lut[(((r << LUT_BITS) | g) << LUT_BITS) | b]);
+}
 
 
 int color_name_to_id(char *name) {
@@ -34,8 +161,8 @@ int color_name_to_id(char *name) {
     if (strlen(name) == 6) {
         sscanf(name, "%6x", &x);
         snprintf(buffer, 7, "%06x", x);
-        if (strcmp(name, buffer) == 0) {
-            return(x);
+        if (strcasecmp(name, buffer) == 0) {
+            return(color_rgb_to_id((x >> 16) & 0xff, (x >> 8) & 0xff, x & 0xff));
         }
     }
 
@@ -45,34 +172,87 @@ int color_name_to_id(char *name) {
 
 // The background color.
 int color_bg() {
-    return(color_background);
+    return(slots[SLOT_BG]);
 }
 
 
 void color_set_bg(unsigned id) {
-    color_background = id;
+    slots[SLOT_BG] = id;
 }
 
 
 // The foreground color.
 int color_fg() {
-    return(color_foreground);
+    return(slots[SLOT_FG]);
 }
 
 
 void color_set_fg(unsigned id) {
-    color_foreground = id;
+    slots[SLOT_FG] = id;
+    slots[SLOT_BLUR] = id;
+}
+
+
+unsigned color_slot(unsigned id) {
+    unsigned i, best = SLOT_FIXED;
+    unsigned r, g, b;
+    unsigned distance, best_distance = ~0u;
+    int dr, dg, db;
+
+    for (i = SLOT_FIXED; i < slot_count; i++) {
+        if (slots[i] == id) {
+            return(i);
+        }
+    }
+
+    if (slot_count < 256) {
+        slots[slot_count] = id;
+        return(slot_count++);
+    }
+
+    // Out of slots, share the one closest in color.
+    color_to_rgb(id, &r, &g, &b);
+    for (i = SLOT_FIXED; i < slot_count; i++) {
+        dr = (int) palette[slots[i]].r - (int) r;
+        dg = (int) palette[slots[i]].g - (int) g;
+        db = (int) palette[slots[i]].b - (int) b;
+        distance = dr * dr + dg * dg + db * db;
+
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = i;
+        }
+    }
+
+    return(best);
+}
+
+
+unsigned color_slot_to_id(unsigned slot) {
+    return(slots[slot & 0xff]);
+}
+
+
+void color_slot_to_rgb(unsigned slot, unsigned *r, unsigned *g, unsigned *b) {
+    color_to_rgb(slots[slot & 0xff], r, g, b);
+}
+
+
+void color_swap_theme() {
+    unsigned id = slots[SLOT_BG];
+
+    slots[SLOT_BG] = slots[SLOT_FG];
+    slots[SLOT_FG] = id;
+    slots[SLOT_BLUR] = id;
 }
 
 
 void color_to_rgb(unsigned id, unsigned *r, unsigned *g, unsigned *b) {
-    if (id < sizeof(colors) / sizeof(colors[0])) {
-        *r = colors[id].r;
-        *g = colors[id].g;
-        *b = colors[id].b;
+    if (id < palette_count) {
+        *r = palette[id].r;
+        *g = palette[id].g;
+        *b = palette[id].b;
     } else {
-        *r = ((id & 0xff0000) >> 16) & 0xff;
-        *g = ((id & 0x00ff00) >>  8) & 0xff;
-        *b = ((id & 0x0000ff)      ) & 0xff;
+        *r = *g = *b = 0;
     }
 }
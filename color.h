@@ -13,19 +13,53 @@ typedef struct {
 
 extern color_t colors[];
 
-// Return -1 on not found, otherwise index to colors[]
+// Set up the palette with the named colors.  Has to come before anything
+// else here, and before any threads are started.
+void color_init();
+
+// Return -1 on not found, otherwise the color id.  The id of a
+// named color is its index in colors[], an RGB tuple gets a new id.
 int color_name_to_id(char *name);
 
+// The id for an RGB value, which is added to the palette if new.  When
+// the palette is full, the id of the closest color is returned.
+unsigned color_rgb_to_id(unsigned r, unsigned g, unsigned b);
+
 int color_bg();
 int color_fg();
 
-// Returns the color we set to, or -1 on failure
+// Set the color of the background slot
 void color_set_bg(unsigned id);
 
-// Returns the color we set to, or -1 on failure
+// Set the color of the text (and blur) slots
 void color_set_fg(unsigned id);
 
 // For a given color ID, return the RGB triple
 void color_to_rgb(unsigned id, unsigned *r, unsigned *g, unsigned *b);
 
+
+/*
+ * Images are drawn with logical color slots rather than colors.  A slot
+ * is only turned into a color when the palette is written, so the same
+ * pixels can be written again with a different theme.
+ */
+
+#define SLOT_BG     0       // Background, follows color_set_bg()
+#define SLOT_FG     1       // Text, follows color_set_fg()
+#define SLOT_BORDER 2       // Thin line around the image
+#define SLOT_BLUR   3       // Blurred text, same as the text by default
+#define SLOT_FIXED  4       // First slot that's always one color (i.e. boxes)
+
+// A slot that's always the given color, shared by anything using that color.
+unsigned color_slot(unsigned id);
+
+// The color id a slot currently resolves to
+unsigned color_slot_to_id(unsigned slot);
+
+// For a given slot, return the RGB triple of its color
+void color_slot_to_rgb(unsigned slot, unsigned *r, unsigned *g, unsigned *b);
+
+// The alternate theme, swapping the background and text colors.
+void color_swap_theme();
+
 #endif
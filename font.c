@@ -1,32 +1,97 @@
 #include "types.h"
 #include "font.h"
 #include "monaco_compressed_large.h"
+#include "font_8x13.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 char *font_data = NULL;
 
+/*
+ * Glyphs beyond ASCII are found through two levels of pages, the high
+ * bits of the code point and then the low byte.  A page is only made
+ * when something in it is first asked for, so memory follows what the
+ * text actually uses.  ASCII and the letters that are ASCII with an
+ * accent share the glyphs of the font, box drawing and block elements
+ * are drawn here, anything else gets the replacement glyph.
+ */
+#define PAGE_COUNT (0x110000 >> 8)
+
+static char **font_pages[PAGE_COUNT];
+static char *font_replacement = NULL;
+
+/*
+ * The built in fonts are unpacked whole, they're small.  A font loaded
+ * from a file stays mapped.  Loading only notes where in
+ * the file each code point's glyph is, through pages the same as the
+ * glyphs, and a glyph is unpacked to a byte a pixel when its page is
+ * made.
+ */
+#define FORMAT_MONACO 0
+#define FORMAT_8X13   1
+#define FORMAT_PSF2   2
+#define FORMAT_BDF    3
+
+#define PSF2_MAGIC        0x864ab572
+#define PSF2_HEADER_SIZE  32
+#define PSF2_HAS_UNICODE  1
+
+static unsigned font_cell_width = FONT_MONACO_WIDTH;
+static unsigned font_cell_height = FONT_MONACO_HEIGHT;
+static unsigned font_format = FORMAT_MONACO;
+static uint8_t *font_map = NULL;        // A font file, or NULL for those built in
+static uint8_t *font_map_end = NULL;
+static uint8_t **font_index[PAGE_COUNT];
+static unsigned font_row_bytes;         // PSF2 bytes in each row of a glyph
+static int font_ascent;                 // BDF rows above the baseline
+static int font_left;                   // BDF left edge of the bounding box
+
 
 unsigned 
 font_width() {
-    return(14); 
+    return(font_cell_width); 
 }
 
 
 unsigned 
 font_height() { 
-    return(23); 
+    return(font_cell_height); 
+}
+
+
+// The 8x13 font has no DEL, blurred text, so it's made a solid block.
+static void font_fill_8x13() {
+    unsigned ch, x, y;
+    char *dst = font_data;
+
+    for (ch = 0; ch < 95; ch++) {
+        for (y = 0; y < FONT_8X13_HEIGHT; y++) {
+            for (x = 0; x < FONT_8X13_WIDTH; x++) {
+                *(dst++) = (font_8x13[ch][y] >> (7 - x)) & 1;
+            }
+        }
+    }
+    memset(dst, 1, FONT_8X13_WIDTH * FONT_8X13_HEIGHT);
 }
 
 
 static void font_fill() {
     char *dst = NULL;
     char *src = font_compressed;
-    unsigned amount = (128 - 32) * 23 * 14;
+    unsigned amount = (128 - 32) * font_cell_height * font_cell_width;
     unsigned byte, i, zero = 0;
 
     font_data = (char *) malloc(amount);
     assert(font_data);
     dst = font_data;
 
+    if (font_format == FORMAT_8X13) {
+        font_fill_8x13();
+        return;
+    }
+
     while (amount) {
         if (zero) {
             byte = 0;
@@ -54,14 +119,582 @@ static void font_fill() {
 char *font_char_start(unsigned char ch) {
     unsigned offset;
 
-    if (font_data == NULL) {
-        font_fill();
-    }
-
     if ((ch < ' ') || (ch > '\x7f')) {
         ch = ' ';
     }
 
+    if (font_map) {
+        return(font_glyph(ch));
+    }
+
+    if (font_data == NULL) {
+        font_fill();
+    }
+
     offset = (font_width() * font_height()) * (ch - ' ');
     return(font_data + offset);
 }
+
+
+// Latin-1 and Latin Extended-A letters as the ASCII letter they're based on
+static const char *font_latin =
+    "AAAAAAACEEEEIIIIDNOOOOOxOUUUUYPsaaaaaaaceeeeiiiidnooooo/ouuuuypy"
+    "AaAaAaCcCcCcCcDdDdEeEeEeEeEeGgGgGgGgHhHhIiIiIiIiIiJjJjKkkLlLlLlL"
+    "lLlNnNnNnnNnOoOoOoOoRrRrRrSsSsSsSsTtTtTtUuUuUuUuUuUuWwYyYZzZzZzs";
+
+// Arms of box drawing characters U+2500 to U+257F: up, right, down
+// and left, 1 for light, 2 for heavy and 3 for double.  Dashed lines
+// are drawn solid.
+#define BOX(u, r, d, l) ((u) | ((r) << 2) | ((d) << 4) | ((l) << 6))
+
+static const uint8_t font_box[128] = {
+    BOX(0,1,0,1), BOX(0,2,0,2), BOX(1,0,1,0), BOX(2,0,2,0), BOX(0,1,0,1), BOX(0,2,0,2), BOX(1,0,1,0), BOX(2,0,2,0),
+    BOX(0,1,0,1), BOX(0,2,0,2), BOX(1,0,1,0), BOX(2,0,2,0), BOX(0,1,1,0), BOX(0,2,1,0), BOX(0,1,2,0), BOX(0,2,2,0),
+    BOX(0,0,1,1), BOX(0,0,1,2), BOX(0,0,2,1), BOX(0,0,2,2), BOX(1,1,0,0), BOX(1,2,0,0), BOX(2,1,0,0), BOX(2,2,0,0),
+    BOX(1,0,0,1), BOX(1,0,0,2), BOX(2,0,0,1), BOX(2,0,0,2), BOX(1,1,1,0), BOX(1,2,1,0), BOX(2,1,1,0), BOX(1,1,2,0),
+    BOX(2,1,2,0), BOX(2,2,1,0), BOX(1,2,2,0), BOX(2,2,2,0), BOX(1,0,1,1), BOX(1,0,1,2), BOX(2,0,1,1), BOX(1,0,2,1),
+    BOX(2,0,2,1), BOX(2,0,1,2), BOX(1,0,2,2), BOX(2,0,2,2), BOX(0,1,1,1), BOX(0,1,1,2), BOX(0,2,1,1), BOX(0,2,1,2),
+    BOX(0,1,2,1), BOX(0,1,2,2), BOX(0,2,2,1), BOX(0,2,2,2), BOX(1,1,0,1), BOX(1,1,0,2), BOX(1,2,0,1), BOX(1,2,0,2),
+    BOX(2,1,0,1), BOX(2,1,0,2), BOX(2,2,0,1), BOX(2,2,0,2), BOX(1,1,1,1), BOX(1,1,1,2), BOX(1,2,1,1), BOX(1,2,1,2),
+    BOX(2,1,1,1), BOX(1,1,2,1), BOX(2,1,2,1), BOX(2,1,1,2), BOX(2,2,1,1), BOX(1,1,2,2), BOX(1,2,2,1), BOX(2,2,1,2),
+    BOX(1,2,2,2), BOX(2,1,2,2), BOX(2,2,2,1), BOX(2,2,2,2), BOX(0,1,0,1), BOX(0,2,0,2), BOX(1,0,1,0), BOX(2,0,2,0),
+    BOX(0,3,0,3), BOX(3,0,3,0), BOX(0,3,1,0), BOX(0,1,3,0), BOX(0,3,3,0), BOX(0,0,1,3), BOX(0,0,3,1), BOX(0,0,3,3),
+    BOX(1,3,0,0), BOX(3,1,0,0), BOX(3,3,0,0), BOX(1,0,0,3), BOX(3,0,0,1), BOX(3,0,0,3), BOX(1,3,1,0), BOX(3,1,3,0),
+    BOX(3,3,3,0), BOX(1,0,1,3), BOX(3,0,3,1), BOX(3,0,3,3), BOX(0,3,1,3), BOX(0,1,3,1), BOX(0,3,3,3), BOX(1,3,0,3),
+    BOX(3,1,0,1), BOX(3,3,0,3), BOX(1,3,1,3), BOX(3,1,3,1), BOX(3,3,3,3), BOX(0,1,1,0), BOX(0,0,1,1), BOX(1,0,0,1),
+    BOX(1,1,0,0), 0, 0, 0, BOX(0,0,0,1), BOX(1,0,0,0), BOX(0,1,0,0), BOX(0,0,1,0),
+    BOX(0,0,0,2), BOX(2,0,0,0), BOX(0,2,0,0), BOX(0,0,2,0), BOX(0,2,0,1), BOX(1,0,2,0), BOX(0,1,0,2), BOX(2,0,1,0)
+};
+
+// Quadrants of U+2596 to U+259F: upper left 1, upper right 2, lower
+// left 4 and lower right 8.
+static const uint8_t font_quadrants[10] = {4, 8, 1, 13, 9, 7, 11, 2, 6, 14};
+
+
+static void font_fill_rect(char *glyph, int left, int top, int right, int bottom, char value) {
+    int width = font_width();
+    int x, y;
+
+    for (y = top; y < bottom; y++) {
+        for (x = left; x < right; x++) {
+            glyph[y * width + x] = value;
+        }
+    }
+}
+
+
+// The arms of a box drawing character, each a band from its edge of
+// the cell in to the far side of the lines it meets.  A double line is
+// a band three lines wide with the middle taken out again, and where
+// doubles meet the middles join up.
+static void font_draw_lines(char *glyph, unsigned arms) {
+    int width = font_width();
+    int height = font_height();
+    int light = (width + 7) / 8;
+    int thick[4];
+    int double_line[4];
+    int across, down, arm, x, y;
+
+    for (arm = 0; arm < 4; arm++) {
+        thick[arm] = ((arms >> (arm * 2)) & 3) * light;
+        double_line[arm] = (((arms >> (arm * 2)) & 3) == 3);
+    }
+    across = (thick[0] > thick[2]) ? thick[0] : thick[2];      // Of the up and down lines
+    down = (thick[1] > thick[3]) ? thick[1] : thick[3];        // Of the left and right lines
+
+    if (thick[0]) {
+        x = (width - thick[0]) / 2;
+        font_fill_rect(glyph, x, 0, x + thick[0], (height + down) / 2, 1);
+    }
+    if (thick[1]) {
+        y = (height - thick[1]) / 2;
+        font_fill_rect(glyph, (width - across) / 2, y, width, y + thick[1], 1);
+    }
+    if (thick[2]) {
+        x = (width - thick[2]) / 2;
+        font_fill_rect(glyph, x, (height - down) / 2, x + thick[2], height, 1);
+    }
+    if (thick[3]) {
+        y = (height - thick[3]) / 2;
+        font_fill_rect(glyph, 0, y, (width + across) / 2, y + thick[3], 1);
+    }
+
+    if (double_line[0]) {
+        x = (width - thick[0]) / 2 + light;
+        font_fill_rect(glyph, x, 0, x + light, (height + down) / 2 - (down ? light : 0), 0);
+    }
+    if (double_line[1]) {
+        y = (height - thick[1]) / 2 + light;
+        font_fill_rect(glyph, (width - across) / 2 + (across ? light : 0), y, width, y + light, 0);
+    }
+    if (double_line[2]) {
+        x = (width - thick[2]) / 2 + light;
+        font_fill_rect(glyph, x, (height - down) / 2 + (down ? light : 0), x + light, height, 0);
+    }
+    if (double_line[3]) {
+        y = (height - thick[3]) / 2 + light;
+        font_fill_rect(glyph, 0, y, (width + across) / 2 - (across ? light : 0), y + light, 0);
+    }
+}
+
+
+// U+2500 to U+259F, drawn rather than taken from the font.
+static void font_draw_box(char *glyph, unsigned code) {
+    int width = font_width();
+    int height = font_height();
+    int n, x, y, q;
+
+    if ((code >= 0x2571) && (code <= 0x2573)) {
+        for (y = 0; y < height; y++) {
+            x = y * width / height;
+            if (code != 0x2572) {
+                glyph[y * width + width - 1 - x] = 1;
+            }
+            if (code != 0x2571) {
+                glyph[y * width + x] = 1;
+            }
+        }
+    } else if (code < 0x2580) {
+        font_draw_lines(glyph, font_box[code - 0x2500]);
+    } else if (code == 0x2580) {
+        font_fill_rect(glyph, 0, 0, width, height / 2, 1);
+    } else if (code <= 0x2588) {
+        n = code - 0x2580;
+        font_fill_rect(glyph, 0, height - height * n / 8, width, height, 1);
+    } else if (code <= 0x258f) {
+        n = 0x2590 - code;
+        font_fill_rect(glyph, 0, 0, width * n / 8, height, 1);
+    } else if (code == 0x2590) {
+        font_fill_rect(glyph, width / 2, 0, width, height, 1);
+    } else if (code <= 0x2593) {
+        // Shades of one, two and three pixels in each square of four
+        n = code - 0x2590;
+        for (y = 0; y < height; y++) {
+            for (x = 0; x < width; x++) {
+                glyph[y * width + x] = (((x ^ y) & 1) * 2 + (y & 1)) < n;
+            }
+        }
+    } else if (code == 0x2594) {
+        font_fill_rect(glyph, 0, 0, width, height / 8, 1);
+    } else if (code == 0x2595) {
+        font_fill_rect(glyph, width - width / 8, 0, width, height, 1);
+    } else {
+        q = font_quadrants[code - 0x2596];
+        for (n = 0; n < 4; n++) {
+            if (q & (1 << n)) {
+                font_fill_rect(glyph, (n & 1) ? width / 2 : 0, (n & 2) ? height / 2 : 0,
+                               (n & 1) ? width : width / 2, (n & 2) ? height : height / 2, 1);
+            }
+        }
+    }
+}
+
+
+// A hollow box, for anything there's no glyph for.
+static char *font_make_replacement() {
+    int width = font_width();
+    int height = font_height();
+    int light = (width + 7) / 8;
+    char *glyph = (char *) calloc(width * height, 1);
+
+    assert(glyph);
+    font_fill_rect(glyph, 1, 2, width - 1, 2 + light, 1);
+    font_fill_rect(glyph, 1, height - 2 - light, width - 1, height - 2, 1);
+    font_fill_rect(glyph, 1, 2, 1 + light, height - 2, 1);
+    font_fill_rect(glyph, width - 1 - light, 2, width - 1, height - 2, 1);
+    return(glyph);
+}
+
+
+// Some punctuation that's close enough to ASCII
+static unsigned font_punctuation(unsigned code) {
+    static const unsigned pairs[][2] = {
+        {0x00a0, ' '}, {0x00ab, '<'}, {0x00b7, '.'}, {0x00bb, '>'}, {0x2010, '-'},
+        {0x2011, '-'}, {0x2012, '-'}, {0x2013, '-'}, {0x2014, '-'}, {0x2018, '\''},
+        {0x2019, '\''}, {0x201c, '"'}, {0x201d, '"'}, {0x2022, '*'}, {0x2032, '\''},
+        {0x2039, '<'}, {0x203a, '>'}, {0x2212, '-'}
+    };
+    unsigned i;
+
+    for (i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        if (pairs[i][0] == code) {
+            return(pairs[i][1]);
+        }
+    }
+
+    return(0);
+}
+
+
+// Where in the file the glyph of a code point is, or NULL.
+static uint8_t *font_find(unsigned code) {
+    uint8_t **page = font_index[code >> 8];
+
+    return(page ? page[code & 0xff] : NULL);
+}
+
+
+static void font_add(unsigned code, uint8_t *where) {
+    uint8_t ***page = font_index + (code >> 8);
+
+    if (code >= 0x110000) {
+        return;
+    }
+
+    if (*page == NULL) {
+        *page = (uint8_t **) calloc(256, sizeof(uint8_t *));
+        assert(*page);
+    }
+    if ((*page)[code & 0xff] == NULL) {
+        (*page)[code & 0xff] = where;
+    }
+}
+
+
+// The next line of a BDF file, or the end.
+static uint8_t *font_next_line(uint8_t *p) {
+    while ((p < font_map_end) && (*(p++) != '\n'))
+        ;
+
+    return(p);
+}
+
+
+// Does the line at p start with keyword?  p is moved past it.
+static unsigned font_keyword(uint8_t **p, char *keyword) {
+    size_t len = strlen(keyword);
+
+    if ((*p + len > font_map_end) || memcmp(*p, keyword, len) ||
+        ((*p + len < font_map_end) && ((*p)[len] > ' '))) {
+        return(false);
+    }
+
+    *p += len;
+    return(true);
+}
+
+
+// Up to count numbers on the rest of the line.  Returns how many.
+static unsigned font_numbers(uint8_t *p, int *values, unsigned count) {
+    unsigned found = 0;
+    int sign;
+
+    while ((found < count) && (p < font_map_end) && (*p != '\n')) {
+        if ((*p == '-') || ((*p >= '0') && (*p <= '9'))) {
+            sign = (*p == '-') ? -1 : 1;
+            p += (*p == '-');
+            values[found] = 0;
+            while ((p < font_map_end) && (*p >= '0') && (*p <= '9')) {
+                values[found] = values[found] * 10 + (*(p++) - '0');
+            }
+            values[found++] *= sign;
+        } else {
+            p++;
+        }
+    }
+
+    return(found);
+}
+
+
+static unsigned font_hex(uint8_t ch) {
+    if ((ch >= '0') && (ch <= '9')) {
+        return(ch - '0');
+    }
+    if (((ch | 0x20) >= 'a') && ((ch | 0x20) <= 'f')) {
+        return((ch | 0x20) - 'a' + 10);
+    }
+
+    return(0);
+}
+
+
+// One pixel set in a glyph, if it's inside the cell.
+static void font_set(char *glyph, int x, int y) {
+    if ((x >= 0) && (x < (int) font_cell_width) && (y >= 0) && (y < (int) font_cell_height)) {
+        glyph[y * font_cell_width + x] = 1;
+    }
+}
+
+
+// A BDF glyph from its STARTCHAR, placed in the cell by its bounding
+// box and clipped to it.
+static void font_unpack_bdf(char *glyph, uint8_t *p) {
+    int bbx[4] = {0, 0, 0, 0};
+    int top, x, y;
+
+    for (; p < font_map_end; p = font_next_line(p)) {
+        if (font_keyword(&p, "BBX")) {
+            font_numbers(p, bbx, 4);
+        } else if (font_keyword(&p, "BITMAP")) {
+            break;
+        } else if (font_keyword(&p, "ENDCHAR")) {
+            return;
+        }
+    }
+
+    top = font_ascent - (bbx[1] + bbx[3]);
+    for (y = 0, p = font_next_line(p); (y < bbx[1]) && (p < font_map_end); y++, p = font_next_line(p)) {
+        for (x = 0; (x < bbx[0]) && (p + x / 4 < font_map_end); x++) {
+            if (font_hex(p[x / 4]) & (8 >> (x % 4))) {
+                font_set(glyph, bbx[2] - font_left + x, top + y);
+            }
+        }
+    }
+}
+
+
+// The glyph of a code point from the loaded font, or NULL if it
+// doesn't have one.
+static char *font_unpack(unsigned code) {
+    uint8_t *where = font_find(code);
+    char *glyph = NULL;
+    unsigned x, y;
+
+    if (where == NULL) {
+        return(NULL);
+    }
+
+    glyph = (char *) calloc(font_cell_width * font_cell_height, 1);
+    assert(glyph);
+
+    if (font_format == FORMAT_BDF) {
+        font_unpack_bdf(glyph, where);
+        return(glyph);
+    }
+
+    for (y = 0; y < font_cell_height; y++) {
+        for (x = 0; x < font_cell_width; x++) {
+            glyph[y * font_cell_width + x] = (where[y * font_row_bytes + x / 8] >> (7 - x % 8)) & 1;
+        }
+    }
+
+    return(glyph);
+}
+
+
+static unsigned font_le32(uint8_t *p) {
+    return(p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned) p[3] << 24));
+}
+
+
+// One UTF-8 character of a PSF2 unicode table.
+static unsigned font_utf8(uint8_t **p) {
+    unsigned ch = *((*p)++);
+    unsigned more = (ch >= 0xf0) ? 3 : (ch >= 0xe0) ? 2 : (ch >= 0xc0) ? 1 : 0;
+    unsigned code = more ? (ch & (0x3f >> more)) : ch;
+
+    while (more-- && (*p < font_map_end) && ((**p & 0xc0) == 0x80)) {
+        code = (code << 6) | (*((*p)++) & 0x3f);
+    }
+
+    return(code);
+}
+
+
+// A PSF2 font, the glyphs are bitmaps of whole bytes a row.  The
+// unicode table, if there is one, lists each glyph's characters.  A
+// sequence of several characters starts with 0xfe, and those aren't
+// used.  0xff ends each glyph's list.
+static unsigned font_load_psf2() {
+    size_t size = font_map_end - font_map;
+    unsigned header, flags, count, charsize, i;
+    uint8_t *glyphs = NULL;
+    uint8_t *p = NULL;
+
+    if ((size < PSF2_HEADER_SIZE) || (font_le32(font_map) != PSF2_MAGIC)) {
+        return(false);
+    }
+
+    header = font_le32(font_map + 8);
+    flags = font_le32(font_map + 12);
+    count = font_le32(font_map + 16);
+    charsize = font_le32(font_map + 20);
+    font_cell_height = font_le32(font_map + 24);
+    font_cell_width = font_le32(font_map + 28);
+    font_row_bytes = (font_cell_width + 7) / 8;
+
+    if ((font_cell_width == 0) || (font_cell_width > 256) || (font_cell_height == 0) || (font_cell_height > 256) ||
+        (charsize < font_row_bytes * font_cell_height) || (header > size) || (count > (size - header) / charsize)) {
+        return(false);
+    }
+
+    glyphs = font_map + header;
+    if (!(flags & PSF2_HAS_UNICODE)) {
+        for (i = 0; i < count; i++) {
+            font_add(i, glyphs + (size_t) i * charsize);
+        }
+        return(true);
+    }
+
+    p = glyphs + (size_t) count * charsize;
+    for (i = 0; (i < count) && (p < font_map_end); i++) {
+        while ((p < font_map_end) && (*p != 0xfe) && (*p != 0xff)) {
+            font_add(font_utf8(&p), glyphs + (size_t) i * charsize);
+        }
+        while ((p < font_map_end) && (*(p++) != 0xff))
+            ;
+    }
+
+    return(true);
+}
+
+
+// A BDF font, only the bounding box of the font and where each
+// character starts are looked at until a glyph is needed.
+static unsigned font_load_bdf() {
+    uint8_t *p = font_map;
+    uint8_t *start = NULL;
+    int values[4];
+
+    if (!font_keyword(&p, "STARTFONT")) {
+        return(false);
+    }
+
+    font_cell_width = 0;
+    for (; p < font_map_end; p = font_next_line(p)) {
+        if (font_keyword(&p, "FONTBOUNDINGBOX")) {
+            if (font_numbers(p, values, 4) != 4) {
+                return(false);
+            }
+            font_cell_width = values[0];
+            font_cell_height = values[1];
+            font_left = values[2];
+            font_ascent = values[1] + values[3];
+        } else if (font_keyword(&p, "STARTCHAR")) {
+            start = p;
+        } else if (font_keyword(&p, "ENCODING")) {
+            if (start && (font_numbers(p, values, 1) == 1) && (values[0] >= 0)) {
+                font_add(values[0], start);
+            }
+        }
+    }
+
+    return((font_cell_width > 0) && (font_cell_width <= 256) && (font_cell_height > 0) && (font_cell_height <= 256));
+}
+
+
+unsigned font_load(char *name) {
+    struct stat info;
+    unsigned answer;
+    int fd;
+
+    if (strcmp(name, "monaco") == 0) {
+        return(true);
+    }
+
+    if (strcmp(name, "8x13") == 0) {
+        font_format = FORMAT_8X13;
+        font_cell_width = FONT_8X13_WIDTH;
+        font_cell_height = FONT_8X13_HEIGHT;
+        return(true);
+    }
+
+    fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        return(false);
+    }
+
+    if ((fstat(fd, &info) < 0) || (info.st_size == 0)) {
+        close(fd);
+        return(false);
+    }
+
+    font_map = (uint8_t *) mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (font_map == MAP_FAILED) {
+        font_map = NULL;
+        return(false);
+    }
+    font_map_end = font_map + info.st_size;
+
+    font_format = FORMAT_PSF2;
+    answer = font_load_psf2();
+    if (!answer) {
+        font_format = FORMAT_BDF;
+        answer = font_load_bdf();
+    }
+
+    if (!answer) {
+        munmap(font_map, info.st_size);
+        font_map = NULL;
+        font_format = FORMAT_MONACO;
+        font_cell_width = FONT_MONACO_WIDTH;
+        font_cell_height = FONT_MONACO_HEIGHT;
+    }
+
+    return(answer);
+}
+
+
+// The glyph of one code point, or NULL when there's none.
+static char *font_make_glyph(unsigned code) {
+    char *glyph = NULL;
+    unsigned ascii = 0;
+
+    // Blurred text is always a solid block.
+    if (font_map && (code == 0x7f)) {
+        code = 0x2588;
+    } else if (font_map) {
+        glyph = font_unpack(code);
+        if (glyph || (code < 0x80)) {
+            return(glyph);
+        }
+    }
+
+    if ((code >= ' ') && (code <= 0x7f)) {
+        ascii = code;
+    } else if ((code >= 0xc0) && (code <= 0x17f)) {
+        ascii = font_latin[code - 0xc0];
+    } else {
+        ascii = font_punctuation(code);
+    }
+    if (ascii) {
+        return(font_map ? font_glyph(ascii) : font_char_start(ascii));
+    }
+
+    if ((code >= 0x2500) && (code <= 0x259f)) {
+        glyph = (char *) calloc(font_width() * font_height(), 1);
+        assert(glyph);
+        font_draw_box(glyph, code);
+    }
+
+    return(glyph);
+}
+
+
+// All 256 glyphs of a page.  It's in place before it's filled, so
+// accented letters can use the ASCII glyphs before them on page 0.
+static void font_make_page(unsigned page) {
+    char **answer = (char **) calloc(256, sizeof(char *));
+    unsigned i;
+
+    assert(answer);
+    if (font_replacement == NULL) {
+        font_replacement = font_make_replacement();
+    }
+
+    font_pages[page] = answer;
+    for (i = 0; i < 256; i++) {
+        answer[i] = font_make_glyph((page << 8) | i);
+        if (answer[i] == NULL) {
+            answer[i] = font_replacement;
+        }
+    }
+}
+
+
+char *font_glyph(unsigned code) {
+    char ***page = NULL;
+
+    if (code >= 0x110000) {
+        code = 0xfffd;
+    }
+
+    page = font_pages + (code >> 8);
+    if (*page == NULL) {
+        font_make_page(code >> 8);
+    }
+
+    return((*page)[code & 0xff]);
+}
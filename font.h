@@ -4,7 +4,26 @@
 // So we can find out the width and height of characters.
 // It's expected the padding is already built in.
 
+// Pick the font: monaco (14x23, the default) or 8x13 are built in,
+// anything else is the file name of a PSF2 or BDF bitmap font.  A file
+// is mapped and only indexed, a page of 256 glyphs is unpacked when the
+// text first uses one of them.
+// Has to come before anything is drawn.  Returns false if it isn't a
+// font that can be read.
+unsigned font_load(char *name);
+
+// Cell sizes of the built in fonts, so drawing can be made for each.
+#define FONT_MONACO_WIDTH   14
+#define FONT_MONACO_HEIGHT  23
+#define FONT_8X13_WIDTH     8
+#define FONT_8X13_HEIGHT    13
+
 unsigned font_width();
 unsigned font_height();
 char *font_char_start(unsigned char ch);
+
+// The glyph of any code point, laid out the same.  Missing ones get a
+// hollow box.  Pages of glyphs are made as they're first needed, which
+// isn't safe to do from several threads at once.
+char *font_glyph(unsigned code);
 #endif
@@ -0,0 +1,99 @@
+// The 8x13 font from support/text_to_image, ' ' to '~'.  A byte a row,
+// turned to start from the top, the leftmost pixel in the top bit.
+static const uint8_t font_8x13[95][13] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},    // space
+    {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00},    // !
+    {0x36, 0x36, 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},    // "
+    {0x00, 0x00, 0x66, 0x66, 0xff, 0x66, 0x66, 0xff, 0x66, 0x66, 0x00, 0x00, 0x00},    // #
+    {0x18, 0x7e, 0xff, 0xd8, 0xf8, 0x7e, 0x1f, 0x1b, 0xff, 0x7e, 0x18, 0x00, 0x00},    // $
+    {0x70, 0xd8, 0xdb, 0x76, 0x0c, 0x18, 0x30, 0x6e, 0xdb, 0x1b, 0x0e, 0x00, 0x00},    // %
+    {0x38, 0x6c, 0xcc, 0xcc, 0xd8, 0x70, 0x70, 0xd8, 0xcf, 0xc6, 0x7f, 0x00, 0x00},    // &
+    {0x0e, 0x0c, 0x1c, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},    // '
+    {0x0c, 0x18, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x18, 0x0c, 0x00, 0x00},    // (
+    {0x30, 0x18, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x18, 0x30, 0x00, 0x00},    // )
+    {0x00, 0x00, 0x99, 0x5a, 0x3c, 0xff, 0x3c, 0x5a, 0x99, 0x00, 0x00, 0x00, 0x00},    // *
+    {0x00, 0x00, 0x18, 0x18, 0x18, 0xff, 0xff, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00},    // +
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x1c, 0x18, 0x30, 0x00, 0x00},    // ,
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},    // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x38, 0x00, 0x00, 0x00},    // .
+    {0x03, 0x03, 0x06, 0x06, 0x0c, 0x0c, 0x18, 0x18, 0x30, 0x30, 0x60, 0x60, 0x00},    // /
+    {0x3c, 0x66, 0xc3, 0xc7, 0xcf, 0xdb, 0xf3, 0xe3, 0xc3, 0x66, 0x3c, 0x00, 0x00},    // 0
+    {0x18, 0x38, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x00, 0x00},    // 1
+    {0x7e, 0xe7, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0, 0xc0, 0xff, 0x00, 0x00},    // 2
+    {0x7e, 0xe7, 0x03, 0x03, 0x07, 0x7e, 0x07, 0x03, 0x03, 0xe7, 0x7e, 0x00, 0x00},    // 3
+    {0x0c, 0x1c, 0x3c, 0x6c, 0xcc, 0xff, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x00, 0x00},    // 4
+    {0xff, 0xc0, 0xc0, 0xc0, 0xc0, 0xfe, 0x07, 0x03, 0x03, 0xe7, 0x7e, 0x00, 0x00},    // 5
+    {0x7e, 0xe7, 0xc0, 0xc0, 0xc0, 0xfe, 0xc7, 0xc3, 0xc3, 0xe7, 0x7e, 0x00, 0x00},    // 6
+    {0xff, 0x03, 0x03, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00},    // 7
+    {0x7e, 0xe7, 0xc3, 0xc3, 0xe7, 0x7e, 0xe7, 0xc3, 0xc3, 0xe7, 0x7e, 0x00, 0x00},    // 8
+    {0x7e, 0xe7, 0xc3, 0xc3, 0xe7, 0x7f, 0x03, 0x03, 0x03, 0xe7, 0x7e, 0x00, 0x00},    // 9
+    {0x00, 0x00, 0x00, 0x00, 0x38, 0x38, 0x00, 0x00, 0x38, 0x38, 0x00, 0x00, 0x00},    // :
+    {0x00, 0x00, 0x00, 0x1c, 0x1c, 0x00, 0x00, 0x1c, 0x1c, 0x18, 0x30, 0x00, 0x00},    // ;
+    {0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0, 0x60, 0x30, 0x18, 0x0c, 0x06, 0x00, 0x00},    // <
+    {0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0x00, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00},    // =
+    {0x60, 0x30, 0x18, 0x0c, 0x06, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0x00, 0x00},    // >
+    {0x7e, 0xc3, 0xc3, 0x03, 0x06, 0x0c, 0x18, 0x18, 0x00, 0x00, 0x18, 0x00, 0x00},    // ?
+    {0x00, 0x00, 0x00, 0x7e, 0xc3, 0xdd, 0xd3, 0xdb, 0xcf, 0x60, 0x3f, 0x00, 0x00},    // @
+    {0x18, 0x3c, 0x66, 0xc3, 0xc3, 0xc3, 0xff, 0xc3, 0xc3, 0xc3, 0xc3, 0x00, 0x00},    // A
+    {0xfe, 0xc7, 0xc3, 0xc3, 0xc7, 0xfe, 0xc7, 0xc3, 0xc3, 0xc7, 0xfe, 0x00, 0x00},    // B
+    {0x7e, 0xe7, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xe7, 0x7e, 0x00, 0x00},    // C
+    {0xfc, 0xce, 0xc7, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc7, 0xce, 0xfc, 0x00, 0x00},    // D
+    {0xff, 0xc0, 0xc0, 0xc0, 0xc0, 0xfc, 0xc0, 0xc0, 0xc0, 0xc0, 0xff, 0x00, 0x00},    // E
+    {0xff, 0xc0, 0xc0, 0xc0, 0xfc, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0x00, 0x00},    // F
+    {0x7e, 0xe7, 0xc0, 0xc0, 0xc0, 0xc0, 0xcf, 0xc3, 0xc3, 0xe7, 0x7e, 0x00, 0x00},    // G
+    {0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xff, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0x00, 0x00},    // H
+    {0x7e, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x00, 0x00},    // I
+    {0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0xc6, 0xee, 0x7c, 0x00, 0x00},    // J
+    {0xc3, 0xc6, 0xcc, 0xd8, 0xf0, 0xe0, 0xf0, 0xd8, 0xcc, 0xc6, 0xc3, 0x00, 0x00},    // K
+    {0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xff, 0x00, 0x00},    // L
+    {0xc3, 0xe7, 0xff, 0xff, 0xdb, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0x00, 0x00},    // M
+    {0xe3, 0xe3, 0xf3, 0xf3, 0xfb, 0xdb, 0xdf, 0xcf, 0xcf, 0xc7, 0xc7, 0x00, 0x00},    // N
+    {0x7e, 0xe7, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xe7, 0x7e, 0x00, 0x00},    // O
+    {0xfe, 0xc7, 0xc3, 0xc3, 0xc7, 0xfe, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0x00, 0x00},    // P
+    {0x3c, 0x66, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xdb, 0xdf, 0x6e, 0x3f, 0x00, 0x00},    // Q
+    {0xfe, 0xc7, 0xc3, 0xc3, 0xc7, 0xfe, 0xf0, 0xd8, 0xcc, 0xc6, 0xc3, 0x00, 0x00},    // R
+    {0x7e, 0xe7, 0xc0, 0xc0, 0xe0, 0x7e, 0x07, 0x03, 0x03, 0xe7, 0x7e, 0x00, 0x00},    // S
+    {0xff, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00},    // T
+    {0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xe7, 0x7e, 0x00, 0x00},    // U
+    {0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0x66, 0x66, 0x3c, 0x3c, 0x18, 0x00, 0x00},    // V
+    {0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xdb, 0xdb, 0xff, 0xff, 0xe7, 0xc3, 0x00, 0x00},    // W
+    {0xc3, 0x66, 0x66, 0x3c, 0x3c, 0x18, 0x3c, 0x3c, 0x66, 0x66, 0xc3, 0x00, 0x00},    // X
+    {0xc3, 0x66, 0x66, 0x3c, 0x3c, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00},    // Y
+    {0xff, 0x03, 0x03, 0x06, 0x0c, 0x7e, 0x30, 0x60, 0xc0, 0xc0, 0xff, 0x00, 0x00},    // Z
+    {0x3c, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3c, 0x00, 0x00},    // [
+    {0x60, 0x60, 0x30, 0x30, 0x18, 0x18, 0x0c, 0x0c, 0x06, 0x06, 0x03, 0x03, 0x00},    // backslash
+    {0x3c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x3c, 0x00, 0x00},    // ]
+    {0x18, 0x3c, 0x66, 0xc3, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},    // ^
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff},    // _
+    {0x70, 0x30, 0x38, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},    // `
+    {0x00, 0x00, 0x00, 0x00, 0x7e, 0xc3, 0x03, 0x7f, 0xc3, 0xc3, 0x7f, 0x00, 0x00},    // a
+    {0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0xfe, 0xc3, 0xc3, 0xc3, 0xc3, 0xfe, 0x00, 0x00},    // b
+    {0x00, 0x00, 0x00, 0x00, 0x7e, 0xc3, 0xc0, 0xc0, 0xc0, 0xc3, 0x7e, 0x00, 0x00},    // c
+    {0x03, 0x03, 0x03, 0x03, 0x03, 0x7f, 0xc3, 0xc3, 0xc3, 0xc3, 0x7f, 0x00, 0x00},    // d
+    {0x00, 0x00, 0x00, 0x00, 0x7e, 0xc3, 0xc3, 0xfe, 0xc0, 0xc0, 0x7f, 0x00, 0x00},    // e
+    {0x1e, 0x33, 0x30, 0x30, 0x30, 0xfc, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00},    // f
+    {0x00, 0x00, 0x00, 0x00, 0x7e, 0xc3, 0xc3, 0xc3, 0x7f, 0x03, 0x03, 0xc3, 0x7e},    // g
+    {0xc0, 0xc0, 0xc0, 0xc0, 0xfe, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0xc3, 0x00, 0x00},    // h
+    {0x00, 0x18, 0x00, 0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00},    // i
+    {0x00, 0x0c, 0x00, 0x00, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x6c, 0x38},    // j
+    {0xc0, 0xc0, 0xc0, 0xc0, 0xc6, 0xcc, 0xd8, 0xf0, 0xf8, 0xcc, 0xc6, 0x00, 0x00},    // k
+    {0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x00, 0x00},    // l
+    {0x00, 0x00, 0x00, 0x00, 0xfe, 0xdb, 0xdb, 0xdb, 0xdb, 0xdb, 0xdb, 0x00, 0x00},    // m
+    {0x00, 0x00, 0x00, 0x00, 0xfc, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0x00, 0x00},    // n
+    {0x00, 0x00, 0x00, 0x00, 0x7c, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0x7c, 0x00, 0x00},    // o
+    {0x00, 0x00, 0x00, 0x00, 0xfe, 0xc3, 0xc3, 0xc3, 0xc3, 0xfe, 0xc0, 0xc0, 0xc0},    // p
+    {0x00, 0x00, 0x00, 0x00, 0x7f, 0xc3, 0xc3, 0xc3, 0xc3, 0x7f, 0x03, 0x03, 0x03},    // q
+    {0x00, 0x00, 0x00, 0x00, 0xfe, 0xe0, 0xc0, 0xc0, 0xc0, 0xc0, 0xc0, 0x00, 0x00},    // r
+    {0x00, 0x00, 0x00, 0x00, 0x7f, 0xc0, 0xc0, 0x7e, 0x03, 0x03, 0xfe, 0x00, 0x00},    // s
+    {0x00, 0x30, 0x30, 0x30, 0xfc, 0x30, 0x30, 0x30, 0x30, 0x36, 0x1c, 0x00, 0x00},    // t
+    {0x00, 0x00, 0x00, 0x00, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0xc6, 0x7e, 0x00, 0x00},    // u
+    {0x00, 0x00, 0x00, 0x00, 0xc3, 0xc3, 0x66, 0x66, 0x3c, 0x3c, 0x18, 0x00, 0x00},    // v
+    {0x00, 0x00, 0x00, 0x00, 0xc3, 0xc3, 0xc3, 0xdb, 0xff, 0xe7, 0xc3, 0x00, 0x00},    // w
+    {0x00, 0x00, 0x00, 0x00, 0xc3, 0x66, 0x3c, 0x18, 0x3c, 0x66, 0xc3, 0x00, 0x00},    // x
+    {0x00, 0x00, 0x00, 0x00, 0xc3, 0x66, 0x66, 0x3c, 0x18, 0x30, 0x60, 0x60, 0xc0},    // y
+    {0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xff, 0x00, 0x00},    // z
+    {0x0f, 0x18, 0x18, 0x18, 0x38, 0xf0, 0x38, 0x18, 0x18, 0x18, 0x0f, 0x00, 0x00},    // {
+    {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},    // |
+    {0xf0, 0x18, 0x18, 0x18, 0x1c, 0x0f, 0x1c, 0x18, 0x18, 0x18, 0xf0, 0x00, 0x00},    // }
+    {0x00, 0x00, 0x00, 0x60, 0xf1, 0x8f, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}     // ~
+};
@@ -0,0 +1,227 @@
+// Based on the GIF89a specification: https://www.w3.org/Graphics/GIF/spec-gif89a.txt
+
+#include "types.h"
+#include "color.h"
+#include "bmp.h"
+#include "gif.h"
+
+#define LZW_MIN_CODE_SIZE 8
+#define LZW_CLEAR         256
+#define LZW_END           257
+#define LZW_MAX_CODE      4095
+#define LZW_HASH_SIZE     8192      // Power of 2, at most half full
+
+#define GIF_PALETTE_OFFSET 13       // Right after the logical screen descriptor
+
+
+struct gif_t {
+    FILE *fp;
+    unsigned width;
+    unsigned height;
+
+    // LZW dictionary, a (prefix code, pixel) pair to its code.
+    unsigned keys[LZW_HASH_SIZE];
+    unsigned short codes[LZW_HASH_SIZE];
+
+    // Bits not yet written and the data sub-block being filled.
+    unsigned bits;
+    unsigned bit_count;
+    uint8_t block[256];
+    unsigned block_len;
+};
+
+
+static void gif_write_16(FILE *fp, unsigned value) {
+    fputc(value & 0xff, fp);
+    fputc((value >> 8) & 0xff, fp);
+}
+
+
+// The global color table, every slot with its current color.
+static void gif_write_palette(FILE *fp) {
+    unsigned slot, r, g, b;
+
+    for (slot = 0; slot < 256; slot++) {
+        color_slot_to_rgb(slot, &r, &g, &b);
+        fputc(r, fp);
+        fputc(g, fp);
+        fputc(b, fp);
+    }
+}
+
+
+struct gif_t *gif_open(char *filename, unsigned width, unsigned height) {
+    struct gif_t *answer = NULL;
+
+    if ((width > 0xffff) || (height > 0xffff)) {
+        fprintf(stderr, "Image is too large for a GIF file\n");
+        exit(EXIT_FAILURE);
+    }
+
+    answer = (struct gif_t *) malloc(sizeof(struct gif_t));
+    assert(answer);
+
+    answer->fp = fopen(filename, "wb");
+    assert(answer->fp);
+    answer->width = width;
+    answer->height = height;
+
+    fprintf(answer->fp, "GIF89a");
+    gif_write_16(answer->fp, width);
+    gif_write_16(answer->fp, height);
+    fputc(0xf7, answer->fp);            // 256 entry global color table
+    fputc(SLOT_BG, answer->fp);         // Background
+    fputc(0, answer->fp);               // Square pixels
+    gif_write_palette(answer->fp);
+
+    // Netscape extension, loop forever
+    fputc(0x21, answer->fp);
+    fputc(0xff, answer->fp);
+    fputc(11, answer->fp);
+    fprintf(answer->fp, "NETSCAPE2.0");
+    fputc(3, answer->fp);
+    fputc(1, answer->fp);
+    gif_write_16(answer->fp, 0);
+    fputc(0, answer->fp);
+
+    return(answer);
+}
+
+
+static void lzw_flush_block(struct gif_t *gif) {
+    if (gif->block_len) {
+        fputc(gif->block_len, gif->fp);
+        assert(fwrite(gif->block, 1, gif->block_len, gif->fp) == gif->block_len);
+        gif->block_len = 0;
+    }
+}
+
+
+// Codes are packed least significant bit first.
+static void lzw_write_code(struct gif_t *gif, unsigned code, unsigned size) {
+    gif->bits |= code << gif->bit_count;
+    gif->bit_count += size;
+
+    while (gif->bit_count >= 8) {
+        gif->block[gif->block_len++] = gif->bits & 0xff;
+        gif->bits >>= 8;
+        gif->bit_count -= 8;
+
+        if (gif->block_len == 255) {
+            lzw_flush_block(gif);
+        }
+    }
+}
+
+
+static void lzw_reset(struct gif_t *gif) {
+    memset(gif->keys, 0xff, sizeof(gif->keys));
+}
+
+
+void gif_add_frame(struct gif_t *gif, struct image_t *bmp, unsigned left, unsigned top, unsigned width, unsigned height, unsigned delay) {
+    unsigned x, y, h, key;
+    unsigned prefix = 0;
+    unsigned next = LZW_END;
+    unsigned size = LZW_MIN_CODE_SIZE + 1;
+    unsigned first = true;
+    uint8_t *s = NULL;
+    uint8_t *background = NULL;
+
+    if ((width == 0) || (height == 0)) {
+        return;
+    }
+
+    background = (uint8_t *) malloc(bmp_width(bmp));
+    assert(background);
+    memset(background, SLOT_BG, bmp_width(bmp));
+
+    // Graphic control: leave the frame in place, no transparency.
+    fputc(0x21, gif->fp);
+    fputc(0xf9, gif->fp);
+    fputc(4, gif->fp);
+    fputc(0x04, gif->fp);
+    gif_write_16(gif->fp, delay);
+    fputc(0, gif->fp);
+    fputc(0, gif->fp);
+
+    // Image descriptor, no local color table
+    fputc(0x2c, gif->fp);
+    gif_write_16(gif->fp, left);
+    gif_write_16(gif->fp, top);
+    gif_write_16(gif->fp, width);
+    gif_write_16(gif->fp, height);
+    fputc(0, gif->fp);
+
+    fputc(LZW_MIN_CODE_SIZE, gif->fp);
+    gif->bits = 0;
+    gif->bit_count = 0;
+    gif->block_len = 0;
+    lzw_reset(gif);
+    lzw_write_code(gif, LZW_CLEAR, size);
+
+    for (y = top; y < top + height; y++) {
+        s = (y < bmp_height(bmp)) ? bmp_row(bmp, y) : background;
+        s += left;
+
+        for (x = 0; x < width; x++, s++) {
+            if (first) {
+                prefix = *s;
+                first = false;
+                continue;
+            }
+
+            // Is prefix + this pixel already known?
+            key = (prefix << 8) | *s;
+            h = (key * 2654435761u >> 19) & (LZW_HASH_SIZE - 1);
+            while ((gif->keys[h] != key) && (gif->keys[h] != ~0u)) {
+                h = (h + 1) & (LZW_HASH_SIZE - 1);
+            }
+
+            if (gif->keys[h] == key) {
+                prefix = gif->codes[h];
+                continue;
+            }
+
+            lzw_write_code(gif, prefix, size);
+
+            next++;
+            gif->keys[h] = key;
+            gif->codes[h] = next;
+            if (next >= (1u << size)) {
+                size++;
+            }
+
+            // Out of codes, start over.
+            if (next == LZW_MAX_CODE) {
+                lzw_write_code(gif, LZW_CLEAR, size);
+                lzw_reset(gif);
+                next = LZW_END;
+                size = LZW_MIN_CODE_SIZE + 1;
+            }
+
+            prefix = *s;
+        }
+    }
+
+    lzw_write_code(gif, prefix, size);
+    lzw_write_code(gif, LZW_END, size);
+    if (gif->bit_count) {
+        lzw_write_code(gif, 0, 8 - gif->bit_count);
+    }
+    lzw_flush_block(gif);
+    fputc(0, gif->fp);              // Block terminator
+
+    free(background);
+}
+
+
+void gif_close(struct gif_t *gif) {
+    fputc(0x3b, gif->fp);           // Trailer
+
+    fseek(gif->fp, GIF_PALETTE_OFFSET, SEEK_SET);
+    gif_write_palette(gif->fp);
+
+    fclose(gif->fp);
+    free(gif);
+}
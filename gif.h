@@ -0,0 +1,26 @@
+#ifndef GIF_H
+#define GIF_H
+
+#include "types.h"
+#include "bmp.h"
+
+// Animated GIF, each frame is only the part that changed.
+
+typedef struct gif_t gif_dummy;
+
+
+// Start a GIF file of width x height pixels, it loops forever.
+struct gif_t *gif_open(char *filename, unsigned width, unsigned height);
+
+
+// Add the rectangle of the image at left, top of width x height pixels as
+// the next frame, shown for delay hundredths of a second.  Anything
+// below the bottom of the image is background.
+void gif_add_frame(struct gif_t *gif, struct image_t *bmp, unsigned left, unsigned top, unsigned width, unsigned height, unsigned delay);
+
+
+// Finish up.  The color table is written here, since more slots may
+// have come into use since the start.
+void gif_close(struct gif_t *gif);
+
+#endif
@@ -0,0 +1,195 @@
+#include "types.h"
+#include "color.h"
+#include "font.h"
+#include "screen.h"
+#include "html.h"
+
+// Output is collected here and written whenever it fills up.
+#define HTML_BUFSIZE 65536
+
+// Cell styles, anything else is the slot of a box color.
+#define STYLE_PLAIN   0
+#define STYLE_BLUR    1
+
+typedef struct {
+    FILE *fp;
+    char *d;
+    char buffer[HTML_BUFSIZE];
+} html_out_t;
+
+// Kept for the next file, i.e. the other theme.
+static html_out_t *html_out = NULL;
+
+
+static void html_flush(html_out_t *out) {
+    size_t amount = out->d - out->buffer;
+
+    if (amount) {
+        amount -= fwrite(out->buffer, 1, amount, out->fp);
+        assert(amount == 0);
+    }
+    out->d = out->buffer;
+}
+
+
+static void html_puts(html_out_t *out, char *string) {
+    size_t len = strlen(string);
+
+    if (out->d + len > out->buffer + HTML_BUFSIZE) {
+        html_flush(out);
+    }
+
+    memcpy(out->d, string, len);
+    out->d += len;
+}
+
+
+static void html_color(html_out_t *out, unsigned slot) {
+    char color[8];
+    unsigned r, g, b;
+
+    color_slot_to_rgb(slot, &r, &g, &b);
+    snprintf(color, sizeof(color), "#%02x%02x%02x", r, g, b);
+    html_puts(out, color);
+}
+
+
+// Escaped columns start up to end of row r.  Characters beyond ASCII
+// are numeric references, anything else the font can't draw is a space.
+static void html_text(html_out_t *out, struct screen_t *screen, unsigned r, unsigned start, unsigned end) {
+    char *p = screen_row(screen, r);
+    char ch;
+
+    for (; start < end; start++) {
+        // Worst case is a &#x10ffff; and the NUL sprintf() adds
+        if (out->d + 11 > out->buffer + HTML_BUFSIZE) {
+            html_flush(out);
+        }
+
+        ch = p[start];
+        if (ch == SCREEN_UNICODE) {
+            out->d += sprintf(out->d, "&#x%x;", screen_code(screen, r, start));
+        } else if (ch == SCREEN_WIDE_RIGHT) {
+            continue;
+        } else if (ch == '&') {
+            memcpy(out->d, "&amp;", 5);
+            out->d += 5;
+        } else if (ch == '<') {
+            memcpy(out->d, "&lt;", 4);
+            out->d += 4;
+        } else if (ch == '>') {
+            memcpy(out->d, "&gt;", 4);
+            out->d += 4;
+        } else if (((unsigned char) ch < ' ') || ((unsigned char) ch >= 0x7f)) {
+            *(out->d++) = ' ';
+        } else {
+            *(out->d++) = ch;
+        }
+    }
+}
+
+
+static void html_span(html_out_t *out, unsigned style, struct screen_t *screen, unsigned r, unsigned start, unsigned end) {
+    if (style == STYLE_PLAIN) {
+        html_text(out, screen, r, start, end);
+    } else if (style == STYLE_BLUR) {
+        html_puts(out, "<span style=\"background:");
+        html_color(out, SLOT_BLUR);
+        html_puts(out, "\">");
+        while (start++ < end) {
+            html_puts(out, " ");
+        }
+        html_puts(out, "</span>");
+    } else {
+        html_puts(out, "<span style=\"outline:2px solid ");
+        html_color(out, style);
+        html_puts(out, "\">");
+        html_text(out, screen, r, start, end);
+        html_puts(out, "</span>");
+    }
+}
+
+
+void html_write_image(char *filename, struct screen_t *screen) {
+    html_out_t *out = NULL;
+    unsigned width = font_width();
+    unsigned height = font_height();
+    unsigned columns = screen_width(screen);
+    unsigned rows = screen_height(screen);
+    unsigned r, c, start, style, next, count, i, end;
+    unsigned top, left;
+    overlay_t *overlays = NULL;
+    overlay_t *o = NULL;
+    char *p = NULL;
+
+    if (html_out == NULL) {
+        html_out = (html_out_t *) malloc(sizeof(html_out_t));
+        assert(html_out);
+    }
+
+    out = html_out;
+    out->d = out->buffer;
+    out->fp = fopen(filename, "w");
+    assert(out->fp);
+
+    overlays = screen_overlays(screen, &count);
+
+    html_puts(out, "<pre style=\"display:inline-block;padding:4px;border:2px solid ");
+    html_color(out, SLOT_BORDER);
+    html_puts(out, ";background:");
+    html_color(out, SLOT_BG);
+    html_puts(out, ";color:");
+    html_color(out, SLOT_FG);
+    html_puts(out, ";font-family:Monaco,Menlo,Consolas,monospace\">");
+
+    // One pass over the rows.  Neighboring cells with the same style
+    // share a <span>.  Trailing spaces are left off.
+    for (r = 0; r < rows; r++) {
+        p = screen_row(screen, r);
+        top = PADDING_TOP + r * height;
+        start = 0;
+        style = STYLE_PLAIN;
+
+        end = columns;
+        while ((end > 0) && (p[end - 1] == ' ')) {
+            end--;
+        }
+
+        for (c = 0; c <= end; c++) {
+            next = STYLE_PLAIN;
+
+            if (c == end) {
+                next = ~0u;                     // Force the last span out
+            } else if (p[c] == '\x7f') {
+                next = STYLE_BLUR;
+            } else {
+                // Inside a box if the whole cell is inside the outline.
+                left = PADDING_LEFT + c * width;
+                for (i = 0; i < count; i++) {
+                    o = overlays + i;
+                    if ((o->color != SLOT_BORDER) &&
+                        (o->left < left) && (left + width - 1 < o->right) &&
+                        (o->top < top) && (top + height - 1 < o->bottom)) {
+                        next = o->color;
+                    }
+                }
+            }
+
+            if (next != style) {
+                if (c > start) {
+                    html_span(out, style, screen, r, start, c);
+                }
+                start = c;
+                style = next;
+            }
+        }
+
+        html_puts(out, "\n");
+    }
+
+    html_puts(out, "</pre>\n");
+    html_flush(out);
+
+    fclose(out->fp);
+    out->fp = NULL;
+}
@@ -0,0 +1,13 @@
+#ifndef HTML_H
+#define HTML_H
+
+#include "types.h"
+#include "screen.h"
+
+// Write the screen as an HTML snippet: a <pre> block with inline styles,
+// so it can be pasted into a ticket as is.  Text inside a box is a 
+// <span> with an outline in the box color, blurred text is a solid 
+// <span> of spaces.  None of the blurred characters are written.
+void html_write_image(char *filename, struct screen_t *screen);
+
+#endif
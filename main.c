@@ -5,21 +5,31 @@
 #include "types.h"
 #include "color.h"
 #include "screen.h"
+#include "preview.h"
+#include "font.h"
 
 // Declared in types.h
 int g_verbose = 0;
 
 // The options, listed in the same order as the code
 typedef struct {
+    char *alt_file;
     unsigned bg;
     unsigned context;
     unsigned width;
     unsigned height;
     unsigned fg;
+    char *font_name;
     unsigned greedy;
     unsigned wantInsensitive;
+    unsigned page_lines;
+    unsigned animate;
+    unsigned frame_lines;
     char *ofile;
+    unsigned preview;
     char *blur_string;
+    unsigned snippets;
+    unsigned tab_size;
     unsigned box_color;
     char *search_string;
 } options_t;
@@ -27,23 +37,34 @@ typedef struct {
 
 void usage(char *program) {
     fprintf(stderr, "Usage: %s [options] <string to find>\n", program);
+    fprintf(stderr, " -a file    Also output the image with background and foreground swapped\n");
     fprintf(stderr, " -b color   Background color (default black)\n");
-    fprintf(stderr, " -c int     Keep this many lines before and after found for context\n");
-    fprintf(stderr, " -d WxH     Dimensions as <width>x<height, default 80x25\n");
+    fprintf(stderr, " -c int     Keep only lines within int of a match, like grep -C\n");
+    fprintf(stderr, " -d WxH     Dimensions as <width>x<height, default 80x25.  Either or both\n");
+    fprintf(stderr, "              may be auto to fit the input, i.e. autox25 or 80xauto for every line\n");
     fprintf(stderr, " -f color   Foreground color (default light green)\n");
+    fprintf(stderr, " -F font    Font, monaco (14x23, default) or 8x13, or a PSF2 or BDF font file\n");
     fprintf(stderr, " -h         Help\n");
     fprintf(stderr, " -g int     Greedy consuption of strings that are found:\n");
     fprintf(stderr, "              0 (default) exact strings\n");
     fprintf(stderr, "              1 extend leading and trailing alphabet and numbers\n");
     fprintf(stderr, "              2 extend leading and trailing until spacing\n");
     fprintf(stderr, " -i         Case insensitive search\n");
+    fprintf(stderr, " -l int     Split the output into pages of int lines, i.e. out-001.bmp\n");
+    fprintf(stderr, " -n int     Animate the .gif output, a frame every int lines, or 0 for\n");
+    fprintf(stderr, "              every line with the search string\n");
     fprintf(stderr, " -o file    Output image to a file (when matches found or blurring)\n");
+    fprintf(stderr, " -p type    Preview the image in the terminal, type is sixel or kitty\n");
     fprintf(stderr, " -r string  Blur everything below this found string (i.e. Password)\n");
+    fprintf(stderr, " -s         Output an image per match with -c lines of context, i.e. out-match-001.bmp\n");
+    fprintf(stderr, " -t int     Tab stops every int columns (default 8)\n");
     fprintf(stderr, " -v int     Verbose level (default 0), larger is more\n");
     fprintf(stderr, " -x color   Box color (default red)\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "At least blur (-r) or a search string must be specified.\n");
     fprintf(stderr, "Colors may be specified as an RGB tuple, i.e. -f c0ffee\n");
+    fprintf(stderr, "Output is BMP, unless the file name ends in .qoi for a fast QOI image\n");
+    fprintf(stderr, "or .svg for a vector drawing, or .html for an HTML snippet, or .gif.\n");
     fprintf(stderr, "\n");
     fprintf(stderr, "Returns number of matches in the $? shell variable.\n");
 
@@ -57,21 +78,33 @@ void parse_opts(options_t *options, int argc, char *argv[]) {
     char *p = NULL;
 
     // Set defaults that the user may override
+    options->alt_file = NULL;
     options->bg = color_name_to_id("black");
     options->context = 0;
     options->width = 80;
     options->height = 25;
     options->fg = color_name_to_id("def_fg");
+    options->font_name = NULL;
     options->greedy = 0;
     options->wantInsensitive = false;
+    options->page_lines = 0;
+    options->animate = false;
+    options->frame_lines = 0;
     options->ofile = NULL;
+    options->preview = 0;
     options->blur_string = NULL;
+    options->snippets = false;
+    options->tab_size = 8;
     options->box_color = color_name_to_id("red");
     options->search_string = NULL;
     
     // Scan the user supplied options
-    while ((opt = getopt(argc, argv, "b:c:d:f:g:hio:r:v:x:")) != -1) {
+    while ((opt = getopt(argc, argv, "a:b:c:d:f:F:g:hil:n:o:p:r:st:v:x:")) != -1) {
         switch(opt) {
+        case 'a':
+            options->alt_file = optarg;
+            break;
+
         case 'b':
             val = color_name_to_id(optarg);
 
@@ -88,15 +121,23 @@ void parse_opts(options_t *options, int argc, char *argv[]) {
             break;
 
         case 'd':
+            // Either may be "auto", kept as 0 until the input is measured.
+            if (strcmp(optarg, "auto") == 0) {
+                options->width = 0;
+                options->height = 0;
+                break;
+            }
+
             p = strchr(optarg, 'x');
             if (p == NULL) {
                 usage(argv[0]);
             }
             *p = '\0';
-            options->width = atoi(optarg);
-            options->height = atoi(p + 1);
+            options->width = strtoul(optarg, NULL, 10);
+            options->height = strtoul(p + 1, NULL, 10);
             
-            if ((options->width == 0) || (options->height == 0) || (options->width > 1023) || (options->height > 1023)) {
+            if (((options->width == 0) && strcmp(optarg, "auto")) || ((options->height == 0) && strcmp(p + 1, "auto")) ||
+                (options->width > SCREEN_MAX_SIZE) || (options->height > SCREEN_MAX_SIZE)) {
                 usage(argv[0]);
             }
             
@@ -113,6 +154,10 @@ void parse_opts(options_t *options, int argc, char *argv[]) {
             options->fg = val;
             break;
 
+        case 'F':
+            options->font_name = optarg;
+            break;
+
         case 'g':
             options->greedy = atoi(optarg);
             break;
@@ -125,14 +170,43 @@ void parse_opts(options_t *options, int argc, char *argv[]) {
             options->wantInsensitive = true;
             break;
 
+        case 'l':
+            options->page_lines = atoi(optarg);
+            break;
+
+        case 'n':
+            options->animate = true;
+            options->frame_lines = atoi(optarg);
+            break;
+
         case 'o':
             options->ofile = optarg;
             break;
 
+        case 'p':
+            options->preview = preview_name_to_id(optarg);
+
+            if (options->preview == 0) {
+                fprintf(stderr, "Unknown preview type\n");
+                usage(argv[0]);
+            }
+            break;
+
         case 'r':
             options->blur_string = optarg;
             break;
 
+        case 's':
+            options->snippets = true;
+            break;
+
+        case 't':
+            options->tab_size = atoi(optarg);
+            if (options->tab_size == 0) {
+                usage(argv[0]);
+            }
+            break;
+
         case 'v':
             g_verbose = atoi(optarg);
             break;
@@ -170,13 +244,99 @@ void parse_opts(options_t *options, int argc, char *argv[]) {
 }
 
 
+// Write the image, and the other theme if wanted.
+void write_images(options_t *options, struct screen_t *screen) {
+    if (options->preview) {
+        screen_preview(screen, options->preview);
+    }
+
+    if (options->ofile == NULL) {
+        return;
+    }
+
+    if (options->snippets) {
+        screen_write_snippets(screen, options->ofile, options->context);
+    } else if (options->page_lines) {
+        screen_write_pages(screen, options->ofile, options->page_lines);
+    } else {
+        screen_write_image(screen, options->ofile);
+    }
+
+    if (options->alt_file) {
+        color_swap_theme();
+        if (options->snippets) {
+            screen_write_snippets(screen, options->alt_file, options->context);
+        } else if (options->page_lines) {
+            screen_write_pages(screen, options->alt_file, options->page_lines);
+        } else {
+            screen_write_theme(screen, options->alt_file);
+        }
+    }
+}
+
+
+// Does this line have what we're looking for?  Only used for animation.
+unsigned has_match(options_t *options, char *line) {
+    if (options->search_string == NULL) {
+        return(false);
+    }
+
+    if (options->wantInsensitive) {
+        return(strcasestr(line, options->search_string) != NULL);
+    }
+
+    return(strstr(line, options->search_string) != NULL);
+}
+
+
+// All of stdin, for measuring before it's printed.  Caller frees.
+char *read_all() {
+    size_t len = 0;
+    size_t max = 65536;
+    size_t amount;
+    char *answer = (char *) malloc(max + 1);
+
+    assert(answer);
+    while ((amount = fread(answer + len, 1, max - len, stdin)) > 0) {
+        len += amount;
+        if (len == max) {
+            max *= 2;
+            answer = (char *) realloc(answer, max + 1);
+            assert(answer);
+        }
+    }
+    answer[len] = '\0';
+
+    return(answer);
+}
+
+
+// Print a line of input, and add a frame if it's time.
+void take_line(options_t *options, struct screen_t *screen, char *line, unsigned *lines) {
+    screen_printf(screen, line);
+
+    if (options->animate && (line[strlen(line) - 1] == '\n')) {
+        *lines += 1;
+        if (options->frame_lines ? (*lines % options->frame_lines == 0) : has_match(options, line)) {
+            screen_add_frame(screen);
+        }
+    }
+}
+
+
 int main(int argc, char *argv[]) {
 #define BUFSIZE 1023
     options_t options;
     struct screen_t *screen = NULL;
     char buffer[BUFSIZE + 1];
+    char *input = NULL;
+    char *line = NULL;
+    char *end = NULL;
+    char save;
     int result = 0;
+    unsigned lines = 0;
 
+    color_init();
     parse_opts(&options, argc, argv);
     if (g_verbose) {
         fprintf(stderr, "Verbosity level: %u\n", g_verbose);
@@ -185,11 +345,64 @@ int main(int argc, char *argv[]) {
     (void) color_set_bg(options.bg);
     (void) color_set_fg(options.fg);
 
+    // The other theme is written by redoing the color table of each slot.
+    bmp_share_colors(options.alt_file == NULL);
+
+    if (options.font_name && !font_load(options.font_name)) {
+        fprintf(stderr, "Can't load the font %s\n", options.font_name);
+        usage(argv[0]);
+    }
+
+    // To fit the width it has to be all read first.  An auto height
+    // keeps every line.
+    if (options.width == 0) {
+        input = read_all();
+        screen_measure(input, options.tab_size, &options.width, &options.height);
+        if (g_verbose) {
+            fprintf(stderr, "Width: %u\n", options.width);
+        }
+    }
+
     screen = screen_new(options.width, options.height);
+    screen_set_tabs(screen, options.tab_size);
+
+    if ((options.page_lines || options.snippets) && options.animate) {
+        fprintf(stderr, "Pages and snippets can't be animated\n");
+        usage(argv[0]);
+    }
+
+    if (options.page_lines && options.snippets) {
+        fprintf(stderr, "Pick either pages or snippets\n");
+        usage(argv[0]);
+    }
+
+    if (options.animate && (options.height == 0)) {
+        fprintf(stderr, "Animation needs a fixed height\n");
+        usage(argv[0]);
+    }
+
+    if (options.animate) {
+        if ((options.ofile == NULL) || !screen_animate(screen, options.ofile)) {
+            fprintf(stderr, "Animation needs a .gif output file\n");
+            usage(argv[0]);
+        }
+    }
 
     // Get input until caller says to stop.
-    while (fgets(buffer, BUFSIZE, stdin)) {
-        screen_printf(screen, buffer);
+    if (input) {
+        for (line = input; *line; line = end) {
+            end = strchr(line, '\n');
+            end = end ? end + 1 : line + strlen(line);
+            save = *end;
+            *end = '\0';
+            take_line(&options, screen, line, &lines);
+            *end = save;
+        }
+        free(input);
+    } else {
+        while (fgets(buffer, BUFSIZE, stdin)) {
+            take_line(&options, screen, buffer, &lines);
+        }
     }
 
     if (options.context) {
@@ -211,18 +424,15 @@ int main(int argc, char *argv[]) {
     // Return count of strings we found if we found any.
     if (result > 0) {
         // Write the image if we want it and there are matches found
-        if (options.ofile) {
-            screen_write_image(screen, options.ofile);
-        }
+        write_images(&options, screen);
         exit(result);
     } else {
         // We didn't find any strings.  If we blurred data, that's a success.
         if (screen_did_blur(screen)) {
-            if (options.ofile) {
-                screen_write_image(screen, options.ofile);
-            }
+            write_images(&options, screen);
             exit(0);
         } else {
+            screen_cancel_animation(screen);
             exit(-1);
         }
     }
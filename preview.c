@@ -0,0 +1,222 @@
+#include "types.h"
+#include "color.h"
+#include "bmp.h"
+#include "preview.h"
+
+// kitty wants the payload in chunks of at most 4096 base64 characters.
+#define KITTY_CHUNK 3072
+
+static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+unsigned preview_name_to_id(char *name) {
+    if (strcasecmp(name, "sixel") == 0) {
+        return(PREVIEW_SIXEL);
+    } else if (strcasecmp(name, "kitty") == 0) {
+        return(PREVIEW_KITTY);
+    }
+
+    return(0);
+}
+
+
+// Sixel repeats are "!<count><char>", only worth it for more than 3.
+static void sixel_run(FILE *fp, unsigned count, char ch) {
+    if (count > 3) {
+        fprintf(fp, "!%u%c", count, ch);
+    } else {
+        while (count--) {
+            fputc(ch, fp);
+        }
+    }
+}
+
+
+// A band is 6 rows of pixels.  For each color in the band there's a pass
+// across it with one character per column, bit n set if row n is that 
+// color.  Between passes, $ goes back to the start of the band.
+static void sixel_write(FILE *fp, struct image_t *bmp) {
+    unsigned width = bmp_width(bmp);
+    unsigned height = bmp_height(bmp);
+    uint8_t defined[256];
+    uint8_t present[256];
+    uint8_t *band = NULL;
+    uint8_t *s = NULL;
+    unsigned y, i, x, rows, slot, count, first;
+    unsigned r, g, b;
+    char ch, last;
+
+    band = (uint8_t *) malloc(6 * (size_t) width);
+    assert(band);
+    memset(defined, false, sizeof(defined));
+
+    // Introducer, 1:1 pixel aspect ratio and the size.
+    fprintf(fp, "\033Pq\"1;1;%u;%u", width, height);
+
+    for (y = 0; y < height; y += 6) {
+        rows = (height - y < 6) ? height - y : 6;
+        memset(present, false, sizeof(present));
+
+        for (i = 0; i < rows; i++) {
+            s = bmp_row(bmp, y + i);
+            memcpy(band + i * width, s, width);
+            for (x = 0; x < width; x++) {
+                present[s[x]] = true;
+            }
+        }
+
+        first = true;
+        for (slot = 0; slot < 256; slot++) {
+            if (!present[slot]) {
+                continue;
+            }
+
+            // Colors are defined the first time they are used, in percent.
+            if (!defined[slot]) {
+                color_slot_to_rgb(slot, &r, &g, &b);
+                fprintf(fp, "#%u;2;%u;%u;%u", slot, r * 100 / 255, g * 100 / 255, b * 100 / 255);
+                defined[slot] = true;
+            }
+
+            if (!first) {
+                fputc('$', fp);
+            }
+            first = false;
+            fprintf(fp, "#%u", slot);
+
+            last = 0;
+            count = 0;
+            for (x = 0; x < width; x++) {
+                ch = 0;
+                for (i = 0; i < rows; i++) {
+                    if (band[i * width + x] == slot) {
+                        ch |= 1 << i;
+                    }
+                }
+                ch += '?';
+
+                if (ch == last) {
+                    count++;
+                } else {
+                    sixel_run(fp, count, last);
+                    last = ch;
+                    count = 1;
+                }
+            }
+
+            // Nothing to draw at the end of the line can be dropped.
+            if (last != '?') {
+                sixel_run(fp, count, last);
+            }
+        }
+
+        fputc('-', fp);
+    }
+
+    fprintf(fp, "\033\\");
+    free(band);
+}
+
+
+static void kitty_chunk(FILE *fp, uint8_t *s, unsigned len, unsigned more) {
+    unsigned value;
+
+    fprintf(fp, "m=%u;", more);
+
+    while (len >= 3) {
+        value = (s[0] << 16) | (s[1] << 8) | s[2];
+        fputc(base64[(value >> 18) & 0x3f], fp);
+        fputc(base64[(value >> 12) & 0x3f], fp);
+        fputc(base64[(value >>  6) & 0x3f], fp);
+        fputc(base64[(value      ) & 0x3f], fp);
+        s += 3;
+        len -= 3;
+    }
+
+    if (len) {
+        value = (s[0] << 16) | ((len > 1) ? (s[1] << 8) : 0);
+        fputc(base64[(value >> 18) & 0x3f], fp);
+        fputc(base64[(value >> 12) & 0x3f], fp);
+        fputc((len > 1) ? base64[(value >> 6) & 0x3f] : '=', fp);
+        fputc('=', fp);
+    }
+
+    fprintf(fp, "\033\\");
+}
+
+
+// Raw RGB, sent as base64 in chunks.  Only the first chunk has the
+// image details, and the last one has m=0.  So a full chunk is held 
+// until it's known whether more follow.
+static void kitty_write(FILE *fp, struct image_t *bmp) {
+    unsigned width = bmp_width(bmp);
+    unsigned height = bmp_height(bmp);
+    uint8_t chunk[KITTY_CHUNK];
+    uint8_t palette[256][3];
+    unsigned len = 0;
+    unsigned y, x, r, g, b;
+    unsigned first = true;
+    uint8_t *s = NULL;
+
+    for (x = 0; x < 256; x++) {
+        color_slot_to_rgb(x, &r, &g, &b);
+        palette[x][0] = r;
+        palette[x][1] = g;
+        palette[x][2] = b;
+    }
+
+    for (y = 0; y < height; y++) {
+        s = bmp_row(bmp, y);
+
+        for (x = 0; x < width; x++) {
+            if (len == KITTY_CHUNK) {
+                if (first) {
+                    fprintf(fp, "\033_Ga=T,f=24,s=%u,v=%u,", width, height);
+                    first = false;
+                } else {
+                    fprintf(fp, "\033_G");
+                }
+                kitty_chunk(fp, chunk, len, 1);
+                len = 0;
+            }
+
+            memcpy(chunk + len, palette[s[x]], 3);
+            len += 3;
+        }
+    }
+
+    if (first) {
+        fprintf(fp, "\033_Ga=T,f=24,s=%u,v=%u,", width, height);
+    } else {
+        fprintf(fp, "\033_G");
+    }
+    kitty_chunk(fp, chunk, len, 0);
+}
+
+
+void preview_write_image(struct image_t *bmp, unsigned preview) {
+    struct image_t *scaled = NULL;
+    unsigned factor = 1;
+
+    while ((bmp_width(bmp) / factor > PREVIEW_MAX_WIDTH) || (bmp_height(bmp) / factor > PREVIEW_MAX_HEIGHT)) {
+        factor++;
+    }
+
+    if (factor > 1) {
+        scaled = bmp_new_scaled(bmp, factor);
+        bmp = scaled;
+    }
+
+    if (preview == PREVIEW_SIXEL) {
+        sixel_write(stdout, bmp);
+    } else if (preview == PREVIEW_KITTY) {
+        kitty_write(stdout, bmp);
+    }
+
+    fprintf(stdout, "\n");
+    fflush(stdout);
+
+    if (scaled) {
+        bmp_free(scaled);
+    }
+}
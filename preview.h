@@ -0,0 +1,22 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include "types.h"
+#include "bmp.h"
+
+// Show the image right in the terminal, written to stdout.  Anything 
+// larger than this is shrunk by a whole factor until it fits.
+#define PREVIEW_MAX_WIDTH  1600
+#define PREVIEW_MAX_HEIGHT 1200
+
+#define PREVIEW_SIXEL 1         // DEC sixel graphics (xterm -ti vt340, mlterm, foot, ...)
+#define PREVIEW_KITTY 2         // kitty graphics protocol (kitty, WezTerm, ...)
+
+
+// Returns the preview for a name (sixel, kitty) or 0 if unknown
+unsigned preview_name_to_id(char *name);
+
+
+void preview_write_image(struct image_t *bmp, unsigned preview);
+
+#endif
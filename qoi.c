@@ -0,0 +1,162 @@
+// Based on the QOI specification: https://qoiformat.org/qoi-specification.pdf
+
+#include "types.h"
+#include "color.h"
+#include "bmp.h"
+#include "qoi.h"
+
+#define QOI_OP_INDEX  0x00      // 00xxxxxx
+#define QOI_OP_DIFF   0x40      // 01xxxxxx
+#define QOI_OP_LUMA   0x80      // 10xxxxxx
+#define QOI_OP_RUN    0xc0      // 11xxxxxx
+#define QOI_OP_RGB    0xfe      // 11111110
+#define QOI_OP_RGBA   0xff      // 11111111
+
+#define QOI_HEADER_SIZE 14
+#define QOI_MAX_RUN     62
+
+// Pixels are kept as 0x00RRGGBB, alpha is always 255 for us.
+#define QOI_R(p) (((p) >> 16) & 0xff)
+#define QOI_G(p) (((p) >>  8) & 0xff)
+#define QOI_B(p) (((p)      ) & 0xff)
+#define QOI_HASH(p) ((QOI_R(p) * 3 + QOI_G(p) * 5 + QOI_B(p) * 7 + 255 * 11) % 64)
+
+// Output is buffered, flushed whenever there may not be room for a row.
+#define QOI_BUFSIZE 65536
+
+static const uint8_t qoi_padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+
+static void qoi_write_32(uint8_t *d, unsigned value) {
+    d[0] = (value >> 24) & 0xff;
+    d[1] = (value >> 16) & 0xff;
+    d[2] = (value >>  8) & 0xff;
+    d[3] = (value      ) & 0xff;
+}
+
+
+static void qoi_flush(FILE *fp, uint8_t *start, uint8_t **d) {
+    size_t amount = *d - start;
+
+    if (amount) {
+        amount -= fwrite(start, 1, amount, fp);
+        assert(amount == 0);
+    }
+    *d = start;
+}
+
+
+void qoi_write_image(char *filename, struct image_t *bmp) {
+    unsigned width = bmp_width(bmp);
+    unsigned height = bmp_height(bmp);
+    unsigned palette[256];
+    unsigned index[64];
+    unsigned id, r, g, b, x, y;
+    unsigned px, prev, run;
+    int vr, vg, vb, vg_r, vg_b;
+    uint8_t *buffer = NULL;
+    uint8_t *d = NULL;
+    uint8_t *s = NULL;
+    uint8_t *end = NULL;
+    FILE *outfile = NULL;
+
+    // The image is palette based, so look up every RGB value only once.
+    for (id = 0; id < 256; id++) {
+        color_slot_to_rgb(id, &r, &g, &b);
+        palette[id] = (r << 16) | (g << 8) | b;
+    }
+
+    // A whole row might not compress at all, 4 bytes per pixel at worst.
+    buffer = (uint8_t *) malloc(QOI_BUFSIZE + 4 * (size_t) width);
+    assert(buffer);
+
+    outfile = fopen(filename, "wb");
+    assert(outfile);
+
+    d = buffer;
+    memcpy(d, "qoif", 4);
+    qoi_write_32(d + 4, width);
+    qoi_write_32(d + 8, height);
+    d[12] = 3;                  // RGB
+    d[13] = 0;                  // sRGB with linear alpha
+    d += QOI_HEADER_SIZE;
+
+    memset(index, 0xff, sizeof(index));     // Never matches, alpha is 0 there
+    prev = 0;                   // Black, opaque
+    run = 0;
+
+    for (y = 0; y < height; y++) {
+        s = bmp_row(bmp, y);
+        end = s + width;
+
+        while (s < end) {
+            px = palette[*s];
+
+            // Runs of background are by far the common case, so
+            // scan those as bytes without the table lookup.
+            if (px == prev) {
+                id = *(s++);
+                run++;
+                while ((s < end) && (*s == id)) {
+                    run++;
+                    s++;
+                }
+
+                while (run >= QOI_MAX_RUN) {
+                    *(d++) = QOI_OP_RUN | (QOI_MAX_RUN - 1);
+                    run -= QOI_MAX_RUN;
+                }
+                continue;
+            }
+
+            if (run) {
+                *(d++) = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            x = QOI_HASH(px);
+            if (index[x] == px) {
+                *(d++) = QOI_OP_INDEX | x;
+            } else {
+                index[x] = px;
+
+                vr = (int) QOI_R(px) - (int) QOI_R(prev);
+                vg = (int) QOI_G(px) - (int) QOI_G(prev);
+                vb = (int) QOI_B(px) - (int) QOI_B(prev);
+                vg_r = vr - vg;
+                vg_b = vb - vg;
+
+                if ((vr > -3) && (vr < 2) && (vg > -3) && (vg < 2) && (vb > -3) && (vb < 2)) {
+                    *(d++) = QOI_OP_DIFF | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2);
+                } else if ((vg_r > -9) && (vg_r < 8) && (vg > -33) && (vg < 32) && (vg_b > -9) && (vg_b < 8)) {
+                    *(d++) = QOI_OP_LUMA | (vg + 32);
+                    *(d++) = ((vg_r + 8) << 4) | (vg_b + 8);
+                } else {
+                    *(d++) = QOI_OP_RGB;
+                    *(d++) = QOI_R(px);
+                    *(d++) = QOI_G(px);
+                    *(d++) = QOI_B(px);
+                }
+            }
+
+            prev = px;
+            s++;
+        }
+
+        if (d - buffer >= QOI_BUFSIZE) {
+            qoi_flush(outfile, buffer, &d);
+        }
+    }
+
+    if (run) {
+        *(d++) = QOI_OP_RUN | (run - 1);
+    }
+
+    memcpy(d, qoi_padding, sizeof(qoi_padding));
+    d += sizeof(qoi_padding);
+    qoi_flush(outfile, buffer, &d);
+
+    fclose(outfile);
+    free(buffer);  buffer = NULL;
+}
+
@@ -0,0 +1,15 @@
+#ifndef QOI_H
+#define QOI_H
+
+#include "types.h"
+#include "bmp.h"
+
+// The "Quite OK Image" format, see https://qoiformat.org/qoi-specification.pdf
+// Single pass and table indexed, so it's much faster to produce than the
+// BMP, at the cost of a somewhat larger file.  Meant for quick previews.
+
+
+// Write the image as a 3 channel (RGB) QOI file.
+void qoi_write_image(char *filename, struct image_t *bmp);
+
+#endif
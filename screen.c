@@ -1,140 +1,2012 @@
 #include "screen.h"
 #include "color.h"
+#include "qoi.h"
+#include "svg.h"
+#include "html.h"
+#include "preview.h"
+#include "gif.h"
+#include "ansi.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-// Will have to tinker with these to find a good setting.
-#define PADDING_TOP    5
-#define PADDING_LEFT   5
-#define PADDING_RIGHT  5
-#define PADDING_BOTTOM 5
 
+/*
+ * When we printf a line, typically it's terminated by a NL character. We
+ * don't want to shift the screen up a line if that's the end of the
+ * output - otherwise we end up with an empty line at the bottom of
+ * the screen.  So we overload the x_pos.  It's -1 to indicate that
+ * there is a hidden newline.  Otherwise, it's the x coord of where the
+ * next string will go.
+ */
+
+/*
+ * Nothing is drawn until the image is written.  Every pixel follows from
+ * the characters, the font and the overlays (boxes and the border), so
+ * each pixel row is generated as the encoder asks for it.
+ */
+
+typedef struct {        // A text row drawn once, shared by views
+    pthread_mutex_t lock;
+    uint8_t *pixels;
+} band_t;
+
+
+typedef struct {        // Part of the screen drawn in an image
+    struct screen_t *screen;
+    unsigned first;     // Rows
+    unsigned rows;
+    unsigned left;      // Columns
+    unsigned cols;
+    band_t *bands;      // One per screen row, or NULL to draw as we go
+} view_t;
+
+
+/*
+ * With a height of 0, every line is kept.  The rows go into chunks as
+ * they come in, nothing is ever moved or grown.  Once the text is first
+ * looked at, the final height is known and the chunks are moved into
+ * chars, the same as any other screen.
+ */
+#define CHUNK_ROWS 4096
+
+typedef struct {        // Rows of text, only ever added to
+    char **chunks;
+    pen_t **pens;       // Colors of each chunk, or NULL while all plain ASCII
+    unsigned chunk_count;
+    unsigned chunk_max;
+} store_t;
+
+
+struct screen_t {
+    unsigned width;
+    unsigned height;
+    char *chars;        // Characters, the rows in view start at top
+    unsigned top;
+    int x_pos;
+    unsigned y_pos;     // Cursor row
+    unsigned line_row;  // Row the line being printed started on
+    unsigned margin_top;        // Scrolling region
+    unsigned margin_bottom;     // Last row of it, 0 for the bottom
+    int saved_x;        // Cursor saved by ESC 7
+    unsigned saved_y;
+    pen_t saved_pen;
+    char *alt_chars;    // The other of the main and alternate screens
+    pen_t *alt_cells;
+    unsigned alternate;
+    unsigned did_blur;  // Sometimes we just want blurring, so need to know if we blurred anything
+    overlay_t *overlays;
+    unsigned overlay_count;
+    unsigned overlay_max;
+    uint8_t *atlas;     // Glyphs in color slots, ready to copy into a row
+    struct image_t *image;      // Last image written, for other themes
+    unsigned wrote_bmp;
+    struct gif_t *gif;  // Animation being recorded
+    char *gif_name;
+    unsigned gif_height;
+    char *shot;         // Characters as of the last frame
+    pen_t *shot_pens;
+    uint8_t *dirty;     // Rows written since the last frame, while animating
+    view_t view;        // All of the screen
+    match_t *matches;
+    unsigned match_count;
+    unsigned match_max;
+    store_t *store;     // Rows while capturing, or NULL
+    pen_t *cells;       // Colors of each character and what's beyond ASCII, or NULL while all plain
+    uint8_t *tabs;      // True for each column with a tab stop
+    uint8_t *omitted;   // True for each row standing in for rows left out, or NULL
+    uint8_t *bold;      // Atlas of the glyphs made heavier
+    void (*draw_text)(struct screen_t *, unsigned, unsigned, unsigned, unsigned, uint8_t *);  // Drawing for the font's cell size
+    ansi_t ansi;        // Escape sequence being read
+    pen_t pen;          // What's printed next is drawn with
+    uint8_t pen_slots[256];     // Color slots the text was drawn in
+};
+
+
+typedef struct {        // Units in characters, not pixels
+    unsigned exists;
+    unsigned left;
+    unsigned top;
+    unsigned right;
+    unsigned bottom;
+} box_t;
+
+
+struct screen_t *screen_new(unsigned char_width, unsigned char_height) {
+    struct screen_t *answer = NULL;
+    size_t amount = (size_t) char_width * char_height;
+
+    answer = (struct screen_t *) malloc(sizeof(struct screen_t));
+    assert(answer);
+
+    answer->width = char_width;
+    answer->height = char_height;
+
+    answer->store = NULL;
+    if (char_height == 0) {
+        answer->store = (store_t *) calloc(1, sizeof(store_t));
+        assert(answer->store);
+        amount = 0;
+    }
+
+    answer->chars = (char *) malloc(amount + 1);
+    assert(answer->chars);
+
+    memset(answer->chars, ' ', amount);
+    answer->chars[amount] = '\0';                   // Will make searching easier latter
+
+    answer->top = 0;
+    answer->x_pos = -1;
+    answer->y_pos = char_height ? char_height - 1 : 0;
+    answer->line_row = answer->y_pos;
+    answer->margin_top = 0;
+    answer->margin_bottom = 0;
+    answer->saved_x = 0;
+    answer->saved_y = 0;
+    answer->alt_chars = NULL;
+    answer->alt_cells = NULL;
+    answer->alternate = false;
+    answer->did_blur = false;
+    answer->overlays = NULL;
+    answer->overlay_count = 0;
+    answer->overlay_max = 0;
+    answer->atlas = NULL;
+    answer->image = NULL;
+    answer->wrote_bmp = false;
+    answer->gif = NULL;
+    answer->gif_name = NULL;
+    answer->gif_height = 0;
+    answer->shot = NULL;
+    answer->shot_pens = NULL;
+    answer->dirty = NULL;
+    answer->matches = NULL;
+    answer->match_count = 0;
+    answer->match_max = 0;
+    answer->cells = NULL;
+    answer->bold = NULL;
+    answer->draw_text = NULL;
+    answer->omitted = NULL;
+    answer->tabs = (uint8_t *) malloc(char_width);
+    assert(answer->tabs);
+    screen_set_tabs(answer, 8);
+    ansi_init(&answer->ansi);
+    ansi_default_pen(&answer->pen);
+    ansi_default_pen(&answer->saved_pen);
+    memset(answer->pen_slots, false, sizeof(answer->pen_slots));
+
+    return(answer);
+}
+
+
+static void screen_plain_pens(pen_t *pens, size_t count) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        ansi_default_pen(pens + i);
+    }
+}
+
+
+static int is_plain(pen_t *pen) {
+    return((pen->fg == SLOT_FG) && (pen->bg == SLOT_BG) && (pen->attr == 0) && (pen->code == 0));
+}
+
+
+// A captured row, top row is 0.
+static char *store_row(struct screen_t *screen, unsigned row) {
+    return(screen->store->chunks[row / CHUNK_ROWS] + (size_t) (row % CHUNK_ROWS) * screen->width);
+}
+
+
+// The colors of a captured row, made when first needed.
+static pen_t *store_pens(struct screen_t *screen, unsigned row) {
+    store_t *store = screen->store;
+    pen_t **pens = store->pens + row / CHUNK_ROWS;
+
+    if (*pens == NULL) {
+        *pens = (pen_t *) malloc((size_t) CHUNK_ROWS * screen->width * sizeof(pen_t));
+        assert(*pens);
+        screen_plain_pens(*pens, (size_t) CHUNK_ROWS * screen->width);
+    }
+
+    return(*pens + (size_t) (row % CHUNK_ROWS) * screen->width);
+}
+
+
+// Add a blank row at the bottom while capturing.
+static void store_add_row(struct screen_t *screen) {
+    store_t *store = screen->store;
+    size_t size = (size_t) CHUNK_ROWS * screen->width;
+
+    if (screen->height % CHUNK_ROWS == 0) {
+        if (store->chunk_count == store->chunk_max) {
+            store->chunk_max = store->chunk_max ? store->chunk_max * 2 : 16;
+            store->chunks = (char **) realloc(store->chunks, store->chunk_max * sizeof(char *));
+            assert(store->chunks);
+            store->pens = (pen_t **) realloc(store->pens, store->chunk_max * sizeof(pen_t *));
+            assert(store->pens);
+        }
+
+        store->chunks[store->chunk_count] = (char *) malloc(size);
+        assert(store->chunks[store->chunk_count]);
+        memset(store->chunks[store->chunk_count], ' ', size);
+        store->pens[store->chunk_count] = NULL;
+        store->chunk_count++;
+    }
+
+    screen->height++;
+}
+
+
+// Done capturing, the height is what came in.  Chunks are freed as
+// they're copied, so there's never two copies of the text.
+static void screen_settle(struct screen_t *screen) {
+    store_t *store = screen->store;
+    size_t size = (size_t) CHUNK_ROWS * screen->width;
+    size_t amount, offset;
+    unsigned i;
+
+    if (store == NULL) {
+        return;
+    }
+
+    screen->store = NULL;
+    if (screen->height == 0) {
+        screen->height = 1;
+    }
+
+    amount = (size_t) screen->width * screen->height;
+    screen->chars = (char *) realloc(screen->chars, amount + 1);
+    assert(screen->chars);
+    memset(screen->chars, ' ', amount);
+    screen->chars[amount] = '\0';
+
+    for (i = 0; i < store->chunk_count; i++) {
+        if (store->pens[i] && (screen->cells == NULL)) {
+            screen->cells = (pen_t *) malloc(amount * sizeof(pen_t));
+            assert(screen->cells);
+            screen_plain_pens(screen->cells, amount);
+        }
+    }
+
+    for (i = 0; i < store->chunk_count; i++) {
+        if (amount < size) {
+            size = amount;
+        }
+        offset = (size_t) i * CHUNK_ROWS * screen->width;
+        memcpy(screen->chars + offset, store->chunks[i], size);
+        if (store->pens[i]) {
+            memcpy(screen->cells + offset, store->pens[i], size * sizeof(pen_t));
+            free(store->pens[i]);
+        }
+        amount -= size;
+        free(store->chunks[i]);
+    }
+
+    free(store->chunks);
+    free(store->pens);
+    free(store);
+}
+
+
+// The rows in view, as one string.
+static char *screen_text(struct screen_t *screen) {
+    return(screen->chars + (size_t) screen->top * screen->width);
+}
+
+
+// The colors of the rows in view, lined up with screen_text().
+static pen_t *screen_pens(struct screen_t *screen) {
+    return(screen->cells + (size_t) screen->top * screen->width);
+}
+
+
+// Only ever shrinks, the text is cut off after the view so searches
+// stop there.
+static void screen_set_view(struct screen_t *screen, unsigned top, unsigned height) {
+    screen->top += top;
+    screen->height = height;
+    screen_text(screen)[(size_t) height * screen->width] = '\0';
+}
+
+
+unsigned screen_width(struct screen_t *screen) {
+    return(screen->width);
+}
+
+
+unsigned screen_height(struct screen_t *screen) {
+    screen_settle(screen);
+    return(screen->height);
+}
+
+
+char *screen_row(struct screen_t *screen, unsigned row) {
+    screen_settle(screen);
+    assert(row < screen->height);
+    return(screen_text(screen) + (size_t) row * screen->width);
+}
+
+
+unsigned screen_code(struct screen_t *screen, unsigned row, unsigned c) {
+    unsigned code;
+
+    screen_settle(screen);
+    assert((row < screen->height) && (c < screen->width));
+    if (screen->cells == NULL) {
+        return(0);
+    }
+
+    code = screen_pens(screen)[(size_t) row * screen->width + c].code;
+    return(((code & 0xfffe) == 0xfffe) ? 0xfffd : code);
+}
+
+
+overlay_t *screen_overlays(struct screen_t *screen, unsigned *count) {
+    *count = screen->overlay_count;
+    return(screen->overlays);
+}
+
+
+match_t *screen_matches(struct screen_t *screen, unsigned *count) {
+    *count = screen->match_count;
+    return(screen->matches);
+}
+
+
+// The characters of row y, wherever they're kept.
+static char *screen_line(struct screen_t *screen, unsigned y) {
+    if (screen->store) {
+        return(store_row(screen, y));
+    }
+
+    return(screen_text(screen) + (size_t) y * screen->width);
+}
+
+
+// The pens of row y.  While a row is all plain there may be none, in
+// which case they're only made if asked.
+static pen_t *screen_line_pens(struct screen_t *screen, unsigned y, unsigned make) {
+    size_t amount;
+
+    if (screen->store) {
+        if ((screen->store->pens[y / CHUNK_ROWS] == NULL) && !make) {
+            return(NULL);
+        }
+        return(store_pens(screen, y));
+    }
+
+    if (screen->cells == NULL) {
+        if (!make) {
+            return(NULL);
+        }
+
+        amount = (size_t) screen->width * (screen->top + screen->height);
+        screen->cells = (pen_t *) malloc(amount * sizeof(pen_t));
+        assert(screen->cells);
+        screen_plain_pens(screen->cells, amount);
+    }
+
+    return(screen_pens(screen) + (size_t) y * screen->width);
+}
+
+
+// Rows written since the last frame of an animation.
+static void screen_touch(struct screen_t *screen, unsigned y) {
+    if (screen->dirty) {
+        screen->dirty[y] = true;
+    }
+}
+
+
+void screen_set_tabs(struct screen_t *screen, unsigned tab_size) {
+    unsigned x;
+
+    for (x = 0; x < screen->width; x++) {
+        screen->tabs[x] = (x % tab_size == 0);
+    }
+}
+
+
+// The column of the count'th tab stop right of x, or the last column.
+static unsigned screen_next_tab(struct screen_t *screen, unsigned x, unsigned count) {
+    while (count-- && (x < screen->width - 1)) {
+        for (x++; (x < screen->width - 1) && !screen->tabs[x]; x++)
+            ;
+    }
+
+    return(x);
+}
+
+
+// The column of the count'th tab stop left of x, or the first column.
+static unsigned screen_prev_tab(struct screen_t *screen, unsigned x, unsigned count) {
+    while (count-- && (x > 0)) {
+        for (x--; (x > 0) && !screen->tabs[x]; x--)
+            ;
+    }
+
+    return(x);
+}
+
+
+// Place character ch at screen location x (width), y (height).
+void screen_char(struct screen_t *screen, unsigned char ch, unsigned x, unsigned y) {
+    assert(x < screen->width);
+    assert(y < screen->height);
+
+    screen_line(screen, y)[x] = ch;
+    screen_touch(screen, y);
+}
+
+
+// Keep a pen, inverse is settled here so drawing only ever sees colors.
+static void screen_set_pen(struct screen_t *screen, pen_t *d, pen_t *pen) {
+    *d = *pen;
+    if (pen->attr & ATTR_INVERSE) {
+        d->fg = pen->bg;
+        d->bg = pen->fg;
+        d->attr &= ~ATTR_INVERSE;
+    }
+    screen->pen_slots[d->fg] = true;
+    screen->pen_slots[d->bg] = true;
+}
+
+
+// Writing columns left up to right of row y over half of a wide
+// character blanks the other half, as a terminal does.
+static void screen_split_wide(struct screen_t *screen, unsigned y, unsigned left, unsigned right) {
+    char *line = screen_line(screen, y);
+
+    if ((left > 0) && (line[left] == SCREEN_WIDE_RIGHT)) {
+        line[left - 1] = ' ';
+    }
+    if ((right < screen->width) && (line[right] == SCREEN_WIDE_RIGHT)) {
+        line[right] = ' ';
+    }
+}
+
+
+// Draw character ch with the current pen.  Until a color is used,
+// there's no need to keep any.
+static void screen_put(struct screen_t *screen, unsigned char ch, unsigned x, unsigned y) {
+    pen_t *pens = NULL;
+
+    screen_split_wide(screen, y, x, x + 1);
+    screen_char(screen, ch, x, y);
+
+    pens = screen_line_pens(screen, y, !is_plain(&screen->pen));
+    if (pens) {
+        screen_set_pen(screen, pens + x, &screen->pen);
+    }
+}
+
+
+// Characters from string for count columns of row y, starting at x,
+// all with the current pen.
+static void screen_put_run(struct screen_t *screen, char *string, unsigned count, unsigned x, unsigned y) {
+    pen_t *pens = NULL;
+    unsigned i;
+
+    screen_split_wide(screen, y, x, x + count);
+    memcpy(screen_line(screen, y) + x, string, count);
+    screen_touch(screen, y);
+
+    pens = screen_line_pens(screen, y, !is_plain(&screen->pen));
+    if (pens) {
+        screen_set_pen(screen, pens + x, &screen->pen);
+        for (i = 1; i < count; i++) {
+            pens[x + i] = pens[x];
+        }
+    }
+}
+
+
+// Blank columns left up to right of row y.  Like xterm, the blanks
+// take the current background.
+static void screen_erase(struct screen_t *screen, unsigned y, unsigned left, unsigned right) {
+    pen_t blank;
+    pen_t *pens = NULL;
+    unsigned x;
+
+    if (left >= right) {
+        return;
+    }
+
+    ansi_default_pen(&blank);
+    blank.bg = screen->pen.bg;
+
+    screen_split_wide(screen, y, left, right);
+    memset(screen_line(screen, y) + left, ' ', right - left);
+    screen_touch(screen, y);
+
+    pens = screen_line_pens(screen, y, !is_plain(&blank));
+    for (x = left; pens && (x < right); x++) {
+        screen_set_pen(screen, pens + x, &blank);
+    }
+}
+
+
+// Blank all of rows first up to last.
+static void screen_erase_rows(struct screen_t *screen, unsigned first, unsigned last) {
+    unsigned y;
+
+    for (y = first; y < last; y++) {
+        screen_erase(screen, y, 0, screen->width);
+    }
+}
+
+
+// Row src becomes row dst.
+static void screen_copy_row(struct screen_t *screen, unsigned dst, unsigned src) {
+    pen_t *from = screen_line_pens(screen, src, false);
+    pen_t *to = screen_line_pens(screen, dst, from != NULL);
+
+    memcpy(screen_line(screen, dst), screen_line(screen, src), screen->width);
+    screen_touch(screen, dst);
+
+    if (from) {
+        memcpy(to, from, screen->width * sizeof(pen_t));
+    } else if (to) {
+        screen_plain_pens(to, screen->width);
+    }
+}
+
+
+// Boxes and the border are kept in the order drawn, later ones on top.
+static void screen_add_overlay(struct screen_t *screen, unsigned top, unsigned left, unsigned right, unsigned bottom, unsigned color, unsigned thickness) {
+    overlay_t *o = NULL;
+
+    if (screen->overlay_count == screen->overlay_max) {
+        screen->overlay_max = screen->overlay_max ? screen->overlay_max * 2 : 16;
+        screen->overlays = (overlay_t *) realloc(screen->overlays, screen->overlay_max * sizeof(overlay_t));
+        assert(screen->overlays);
+    }
+
+    o = screen->overlays + screen->overlay_count++;
+    o->top = top;
+    o->left = left;
+    o->right = right;
+    o->bottom = bottom;
+    o->color = color;
+    o->thickness = thickness;
+}
+
+
+// Rows dst on get the count rows from src on.  On a fixed screen
+// the rows are next to each other, so they move in one go.
+static void screen_move_rows(struct screen_t *screen, unsigned dst, unsigned src, unsigned count) {
+    size_t width = screen->width;
+    unsigned y;
+
+    if (screen->store) {
+        for (y = 0; y < count; y++) {
+            screen_copy_row(screen, (dst < src) ? dst + y : dst + count - 1 - y, (dst < src) ? src + y : src + count - 1 - y);
+        }
+        return;
+    }
+
+    memmove(screen_text(screen) + dst * width, screen_text(screen) + src * width, count * width);
+    if (screen->cells) {
+        memmove(screen_pens(screen) + dst * width, screen_pens(screen) + src * width, count * width * sizeof(pen_t));
+    }
+    for (y = dst; y < dst + count; y++) {
+        screen_touch(screen, y);
+    }
+}
+
+
+// Rows top to bottom move up n, blank rows come in at the bottom.
+static void screen_scroll_up(struct screen_t *screen, unsigned top, unsigned bottom, unsigned n) {
+    if (n > bottom - top + 1) {
+        n = bottom - top + 1;
+    }
+
+    screen_move_rows(screen, top, top + n, bottom + 1 - top - n);
+    screen_erase_rows(screen, bottom + 1 - n, bottom + 1);
+}
+
+
+// Rows top to bottom move down n, blank rows come in at the top.
+static void screen_scroll_down(struct screen_t *screen, unsigned top, unsigned bottom, unsigned n) {
+    if (n > bottom - top + 1) {
+        n = bottom - top + 1;
+    }
+
+    screen_move_rows(screen, top + n, top, bottom + 1 - top - n);
+    screen_erase_rows(screen, top, top + n);
+}
+
+
+// Last row of the scrolling region.
+static unsigned screen_margin_bottom(struct screen_t *screen) {
+    return(screen->margin_bottom ? screen->margin_bottom : screen->height - 1);
+}
+
+
+// Down a row, scrolling when at the bottom of the region.  While
+// capturing, the bottom is always a new row.  The start of a wrapped
+// line scrolls along with it.
+static void screen_line_feed(struct screen_t *screen) {
+    unsigned bottom = screen_margin_bottom(screen);
+
+    if (screen->store && (screen->y_pos + 1 >= screen->height)) {
+        store_add_row(screen);
+        screen->y_pos = screen->height - 1;
+        screen_erase(screen, screen->y_pos, 0, screen->width);
+    } else if (screen->y_pos == bottom) {
+        screen_scroll_up(screen, screen->margin_top, bottom, 1);
+        if ((screen->line_row > screen->margin_top) && (screen->line_row <= bottom)) {
+            screen->line_row--;
+        }
+    } else if (screen->y_pos + 1 < screen->height) {
+        screen->y_pos++;
+    }
+}
+
+
+// Up a row, scrolling down when at the top of the region.
+static void screen_reverse_feed(struct screen_t *screen) {
+    if (screen->y_pos == screen->margin_top) {
+        screen_scroll_down(screen, screen->margin_top, screen_margin_bottom(screen), 1);
+    } else if (screen->y_pos > 0) {
+        screen->y_pos--;
+    }
+}
+
+
+// Put the cursor at x, y, kept on the screen.
+static void screen_move_to(struct screen_t *screen, int x, int y) {
+    if (x < 0) {
+        x = 0;
+    } else if (x >= (int) screen->width) {
+        x = screen->width - 1;
+    }
+
+    if (y < 0) {
+        y = 0;
+    } else if (y >= (int) screen->height) {
+        y = screen->height - 1;
+    }
+
+    screen->x_pos = x;
+    screen->y_pos = y;
+}
+
+
+// Switch to or from the alternate screen, which starts out blank.
+// While capturing there's only the one.
+static void screen_alternate(struct screen_t *screen, unsigned on) {
+    size_t amount = (size_t) screen->width * screen->height;
+    char *chars = screen->chars;
+    pen_t *cells = screen->cells;
+    unsigned y;
+
+    if (screen->store || (on == screen->alternate)) {
+        return;
+    }
+
+    if (screen->alt_chars == NULL) {
+        screen->alt_chars = (char *) malloc(amount + 1);
+        assert(screen->alt_chars);
+        screen->alt_chars[amount] = '\0';
+    }
+
+    screen->chars = screen->alt_chars;
+    screen->cells = screen->alt_cells;
+    screen->alt_chars = chars;
+    screen->alt_cells = cells;
+    screen->alternate = on;
+
+    if (on) {
+        screen_erase_rows(screen, 0, screen->height);
+    }
+    for (y = 0; y < screen->height; y++) {
+        screen_touch(screen, y);
+    }
+}
+
+
+static void screen_save_cursor(struct screen_t *screen) {
+    screen->saved_x = screen->x_pos;
+    screen->saved_y = screen->y_pos;
+    screen->saved_pen = screen->pen;
+}
+
+
+// A leftover newline is kept as it was.
+static void screen_restore_cursor(struct screen_t *screen) {
+    screen_move_to(screen, screen->saved_x, screen->saved_y);
+    screen->x_pos = screen->saved_x;
+    screen->pen = screen->saved_pen;
+}
+
+
+// ESC[?...h and ESC[?...l, only the alternate screen matters.
+static void screen_set_mode(struct screen_t *screen, unsigned on) {
+    ansi_t *ansi = &screen->ansi;
+    unsigned i;
+
+    if (ansi->private != '?') {
+        return;
+    }
+
+    for (i = 0; i < ansi->param_count; i++) {
+        if (ansi->params[i] == 1049) {
+            if (on) {
+                screen_save_cursor(screen);
+                screen_alternate(screen, true);
+            } else {
+                screen_alternate(screen, false);
+                screen_restore_cursor(screen);
+            }
+        } else if ((ansi->params[i] == 47) || (ansi->params[i] == 1047)) {
+            screen_alternate(screen, on);
+        }
+    }
+}
+
+
+// ESC[ params final, the VT100 and xterm sequences full screen
+// programs use to move around and clear.  Anything else is ignored.
+static void screen_csi(struct screen_t *screen) {
+    ansi_t *ansi = &screen->ansi;
+    unsigned n = ansi_param(ansi, 0, 1);
+    int x = (screen->x_pos < (int) screen->width) ? screen->x_pos : (int) screen->width - 1;
+    int y = screen->y_pos;
+    unsigned top = (y >= (int) screen->margin_top) ? screen->margin_top : 0;
+    unsigned bottom = (y <= (int) screen_margin_bottom(screen)) ? screen_margin_bottom(screen) : screen->height - 1;
+    char *line = NULL;
+    pen_t *pens = NULL;
+
+    if (ansi->private) {
+        return;
+    }
+
+    switch (ansi->final) {
+    case 'A':           // Cursor up, not past the top of the region
+        screen_move_to(screen, x, ((y - (int) n) < (int) top) ? (int) top : y - (int) n);
+        break;
+
+    case 'B':           // Cursor down
+        screen_move_to(screen, x, ((y + n) > bottom) ? bottom : y + n);
+        break;
+
+    case 'C':           // Cursor right
+        screen_move_to(screen, x + n, y);
+        break;
+
+    case 'D':           // Cursor left
+        screen_move_to(screen, x - (int) n, y);
+        break;
+
+    case 'E':           // Start of a line down
+        screen_move_to(screen, 0, ((y + n) > bottom) ? bottom : y + n);
+        break;
+
+    case 'F':           // Start of a line up
+        screen_move_to(screen, 0, ((y - (int) n) < (int) top) ? (int) top : y - (int) n);
+        break;
+
+    case 'G':           // Column
+    case '`':
+        screen_move_to(screen, n - 1, y);
+        break;
+
+    case 'H':           // Row and column
+    case 'f':
+        screen_move_to(screen, ansi_param(ansi, 1, 1) - 1, n - 1);
+        break;
+
+    case 'd':           // Row
+        screen_move_to(screen, x, n - 1);
+        break;
+
+    case 'J':           // Erase in display
+        n = ansi_param(ansi, 0, 0);
+        if (n == 0) {
+            screen_erase(screen, y, x, screen->width);
+            screen_erase_rows(screen, y + 1, screen->height);
+        } else if (n == 1) {
+            screen_erase_rows(screen, 0, y);
+            screen_erase(screen, y, 0, x + 1);
+        } else {
+            screen_erase_rows(screen, 0, screen->height);
+        }
+        break;
+
+    case 'K':           // Erase in line
+        n = ansi_param(ansi, 0, 0);
+        if (n == 0) {
+            screen_erase(screen, y, x, screen->width);
+        } else if (n == 1) {
+            screen_erase(screen, y, 0, x + 1);
+        } else {
+            screen_erase(screen, y, 0, screen->width);
+        }
+        break;
+
+    case 'X':           // Erase characters
+        screen_erase(screen, y, x, (x + n > screen->width) ? screen->width : x + n);
+        break;
+
+    case 'L':           // Insert lines, inside the region
+        if ((y >= (int) screen->margin_top) && (y <= (int) screen_margin_bottom(screen))) {
+            screen_scroll_down(screen, y, screen_margin_bottom(screen), n);
+        }
+        break;
+
+    case 'M':           // Delete lines
+        if ((y >= (int) screen->margin_top) && (y <= (int) screen_margin_bottom(screen))) {
+            screen_scroll_up(screen, y, screen_margin_bottom(screen), n);
+        }
+        break;
+
+    case '@':           // Insert blanks, the rest of the line moves right
+    case 'P':           // Delete characters, the rest moves left
+        if (n > screen->width - x) {
+            n = screen->width - x;
+        }
+        line = screen_line(screen, y);
+        pens = screen_line_pens(screen, y, false);
+        if (ansi->final == '@') {
+            memmove(line + x + n, line + x, screen->width - x - n);
+            if (pens) {
+                memmove(pens + x + n, pens + x, (screen->width - x - n) * sizeof(pen_t));
+            }
+            screen_erase(screen, y, x, x + n);
+        } else {
+            memmove(line + x, line + x + n, screen->width - x - n);
+            if (pens) {
+                memmove(pens + x, pens + x + n, (screen->width - x - n) * sizeof(pen_t));
+            }
+            screen_erase(screen, y, screen->width - n, screen->width);
+        }
+        break;
+
+    case 'S':           // Scroll up
+        screen_scroll_up(screen, screen->margin_top, screen_margin_bottom(screen), n);
+        break;
+
+    case 'T':           // Scroll down
+        screen_scroll_down(screen, screen->margin_top, screen_margin_bottom(screen), n);
+        break;
+
+    case 'r':           // Scrolling region, needs a fixed height
+        top = ansi_param(ansi, 0, 1) - 1;
+        bottom = ansi_param(ansi, 1, screen->height) - 1;
+        if (screen->store || (top >= bottom) || (bottom >= screen->height)) {
+            break;
+        }
+        screen->margin_top = top;
+        screen->margin_bottom = (bottom == screen->height - 1) ? 0 : bottom;
+        screen_move_to(screen, 0, 0);
+        break;
+
+    case 'I':           // Forward tabs
+        screen->x_pos = screen_next_tab(screen, x, n);
+        break;
+
+    case 'Z':           // Back tabs
+        screen->x_pos = screen_prev_tab(screen, x, n);
+        break;
+
+    case 'g':           // Clear the tab stop here, or all of them
+        n = ansi_param(ansi, 0, 0);
+        if (n == 0) {
+            screen->tabs[x] = false;
+        } else if (n == 3) {
+            memset(screen->tabs, false, screen->width);
+        }
+        break;
+
+    case 's':
+        screen_save_cursor(screen);
+        break;
+
+    case 'u':
+        screen_restore_cursor(screen);
+        break;
+    }
+}
+
+
+// ESC and a single character.
+static void screen_esc(struct screen_t *screen) {
+    switch (screen->ansi.final) {
+    case '7':
+        screen_save_cursor(screen);
+        break;
+
+    case '8':
+        screen_restore_cursor(screen);
+        break;
+
+    case 'D':           // Index
+        screen_line_feed(screen);
+        break;
+
+    case 'E':           // Next line
+        screen_line_feed(screen);
+        screen->x_pos = 0;
+        break;
+
+    case 'M':           // Reverse index
+        screen_reverse_feed(screen);
+        break;
+
+    case 'H':           // Tab stop here
+        if (screen->x_pos < (int) screen->width) {
+            screen->tabs[screen->x_pos] = true;
+        }
+        break;
+
+    case 'c':           // Reset
+        ansi_default_pen(&screen->pen);
+        screen_alternate(screen, false);
+        screen->margin_top = 0;
+        screen->margin_bottom = 0;
+        screen_erase_rows(screen, 0, screen->height);
+        screen_move_to(screen, 0, 0);
+        break;
+    }
+}
+
+
+// Columns that plain text from start up to end takes.
+static size_t screen_columns(char *start, char *end) {
+    ansi_t ansi;
+    size_t answer = 0;
+
+    ansi_init(&ansi);
+    for (; start < end; start++) {
+        if (ansi_feed(&ansi, *start) == ANSI_PRINT) {
+            answer += ansi_width(ansi.code);
+        }
+        if (ansi_again(&ansi)) {
+            start--;
+        }
+    }
+
+    return(answer);
+}
+
+
+// Past any coming text that a later carriage return on the same line
+// writes over completely, as progress bars do, to the \r before the
+// first piece that survives.  It has to start at the beginning of the
+// line.  Only plain text is skipped, a line with escapes or other
+// controls is printed as is.  end is set to the end of the line.
+static char *screen_skip_overwritten(char *string, char **end) {
+    char *p = string;
+    char *start = string;
+    char *piece = NULL;
+    size_t longest = 0;
+    size_t len;
+    unsigned ascii = true;
+
+    while (*p && (*p != '\n')) {
+        if ((((unsigned char) *p < ' ') && (*p != '\r')) || (*p == '\x7f')) {
+            *end = p;
+            return(string);
+        }
+        ascii &= ((unsigned char) *p < 0x80);
+        p++;
+    }
+    *end = p;
+
+    // Back from the end, a piece is written over when a later one is
+    // at least as long.  The first one that isn't is where to start.
+    while (p > string) {
+        piece = p;
+        while ((piece > string) && (piece[-1] != '\r')) {
+            piece--;
+        }
+
+        len = ascii ? (size_t) (p - piece) : screen_columns(piece, p);
+        if (len > longest) {
+            longest = len;
+            start = piece;
+        }
+
+        p = (piece > string) ? piece - 1 : string;
+    }
+
+    return((start > string) ? start - 1 : string);
+}
+
+
+// If we had a leftover newline, handle it by shifting screen and bitmap
+static void screen_pending_newline(struct screen_t *screen) {
+    if (screen->x_pos == -1) {
+        screen_line_feed(screen);
+        screen->x_pos = 0;
+        screen->line_row = screen->y_pos;
+    }
+}
+
+
+// Hit end of line?  Wrap around and keep going.  Not done until
+// there's more, so a line that just fits doesn't leave a blank line
+// after it.
+static void screen_wrap(struct screen_t *screen) {
+    if (screen->x_pos == screen->width) {
+        screen_line_feed(screen);
+        screen->x_pos = 0;
+    }
+}
+
+
+// Print a character beyond ASCII at the cursor.  The row keeps a stand
+// in, the pen the character itself.  Wide ones don't start in the last
+// column, they wrap first.
+static void screen_put_unicode(struct screen_t *screen, unsigned code) {
+    unsigned width = ansi_width(code);
+    unsigned x, y;
+    pen_t *pens = NULL;
+
+    if ((width == 0) || (width > screen->width)) {
+        return;
+    }
+
+    if (screen->x_pos + width > screen->width) {
+        screen_line_feed(screen);
+        screen->x_pos = 0;
+    }
+
+    x = screen->x_pos;
+    y = screen->y_pos;
+    screen_split_wide(screen, y, x, x + width);
+    screen_char(screen, SCREEN_UNICODE, x, y);
+    pens = screen_line_pens(screen, y, true);
+    screen_set_pen(screen, pens + x, &screen->pen);
+    pens[x].code = code;
+
+    if (width == 2) {
+        screen_char(screen, SCREEN_WIDE_RIGHT, x + 1, y);
+        screen_set_pen(screen, pens + x + 1, &screen->pen);
+    }
+
+    screen->x_pos += width;
+}
+
+
+// How much of string is plain text, up to the first control, DEL or
+// byte with the top bit set.  With SSE2 it's checked 16 at a time,
+// the loads are aligned so they never stray onto another page.
+static size_t screen_plain_length(char *string) {
+    char *p = string;
+#ifdef __SSE2__
+    __m128i space = _mm_set1_epi8(' ');
+    __m128i del = _mm_set1_epi8('\x7f');
+    __m128i v;
+    unsigned mask;
+
+    while (((uintptr_t) p & 15) && ((unsigned char) *p >= ' ') && ((unsigned char) *p < '\x7f')) {
+        p++;
+    }
+    if ((uintptr_t) p & 15) {
+        return(p - string);
+    }
+
+    // Signed, so bytes with the top bit set count as below a space.
+    for (;;) {
+        v = _mm_load_si128((__m128i *) p);
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del)));
+        if (mask) {
+            return(p - string + __builtin_ctz(mask));
+        }
+        p += 16;
+    }
+#else
+    while (((unsigned char) *p >= ' ') && ((unsigned char) *p < '\x7f')) {
+        p++;
+    }
+
+    return(p - string);
+#endif
+}
+
+
+// Escape sequences can be split over calls, the parser keeps its
+// place.  Besides colors, enough of a VT100 is followed for the
+// output of full screen programs like top to come out right.  A
+// carriage return goes back to the start of the line, even if it
+// wrapped, and a backspace back a column.
+void screen_printf(struct screen_t *screen, char *string) {
+    ansi_t *ansi = &screen->ansi;
+    char *checked = string;     // Lines up to here were looked ahead at
+    char *skip = NULL;
+    size_t len, count;
+    unsigned action;
+
+    for (; *string; string++) {
+        // At the start of a line, or just back at it, see if what
+        // follows is only going to be written over.
+        if ((string >= checked) && ansi_idle(ansi)) {
+            if (*string == '\r') {
+                skip = screen_skip_overwritten(string + 1, &checked);
+                string = (skip > string + 1) ? skip : string;
+            } else if ((screen->x_pos == -1) || ((screen->x_pos == 0) && (screen->y_pos == screen->line_row))) {
+                string = screen_skip_overwritten(string, &checked);
+            }
+        }
+
+        // Plain text goes in as runs, a row at a time.
+        if (ansi_idle(ansi) && ((unsigned char) *string >= ' ') && ((unsigned char) *string < '\x7f')) {
+            screen_pending_newline(screen);
+            for (len = screen_plain_length(string); len; len -= count) {
+                screen_wrap(screen);
+                count = screen->width - screen->x_pos;
+                count = (len < count) ? len : count;
+                screen_put_run(screen, string, count, screen->x_pos, screen->y_pos);
+                screen->x_pos += count;
+                string += count;
+            }
+            string--;
+            continue;
+        }
+
+        action = ansi_feed(ansi, *string);
+        if (action == ANSI_NONE) {
+            continue;
+        }
+
+        // A UTF-8 character cut short, then what cut it.
+        if (ansi_again(ansi)) {
+            screen_pending_newline(screen);
+            screen_put_unicode(screen, ansi->code);
+            string--;
+            continue;
+        }
+
+        // Neither colors nor modes move the cursor, the rest start by
+        // handling a leftover newline.
+        if ((action == ANSI_CSI) && (ansi->final == 'm')) {
+            if (ansi->private == 0) {
+                ansi_sgr(ansi, &screen->pen);
+            }
+            continue;
+        }
+        if ((action == ANSI_CSI) && ((ansi->final == 'h') || (ansi->final == 'l'))) {
+            screen_set_mode(screen, ansi->final == 'h');
+            continue;
+        }
+
+        screen_pending_newline(screen);
+        if (action == ANSI_CSI) {
+            screen_csi(screen);
+            screen->line_row = screen->y_pos;
+        } else if (action == ANSI_ESC) {
+            screen_esc(screen);
+            screen->line_row = screen->y_pos;
+        } else if (*string == '\n') {
+            screen->x_pos = -1;
+        } else if (*string == '\r') {
+            screen->x_pos = 0;
+            screen->y_pos = screen->line_row;
+        } else if (*string == '\b') {
+            if (screen->x_pos > 0) {
+                screen->x_pos--;
+            }
+        } else if (*string == '\t') {
+            if (screen->x_pos < (int) screen->width) {
+                screen->x_pos = screen_next_tab(screen, screen->x_pos, 1);
+            }
+        } else if ((action == ANSI_PRINT) && (ansi->code >= 0x80)) {
+            screen_put_unicode(screen, ansi->code);
+        } else {
+            screen_wrap(screen);
+            screen_put(screen, *string, screen->x_pos++, screen->y_pos);
+        }
+    }
+}
+
+
+void screen_measure(char *text, unsigned tab_size, unsigned *width, unsigned *height) {
+    unsigned *lengths = NULL;
+    unsigned count = 0;
+    unsigned max = 0;
+    unsigned len, col, i, first, action;
+    char *p = text;
+    ansi_t ansi;
+
+    ansi_init(&ansi);
+
+    // The length of each line as it would be printed, the furthest
+    // it gets when it goes back over itself.
+    do {
+        len = 0;
+        col = 0;
+        while (*p && (*p != '\n')) {
+            action = ansi_feed(&ansi, *p);
+            if ((action == ANSI_CONTROL) && (*p == '\r')) {
+                col = 0;
+            } else if ((action == ANSI_CONTROL) && (*p == '\b')) {
+                col -= (col > 0) ? 1 : 0;
+            } else if ((action == ANSI_CONTROL) && (*p == '\t')) {
+                col = (col / tab_size + 1) * tab_size;
+                len = (col > len) ? col : len;
+            } else if (action == ANSI_PRINT) {
+                col += ansi_width(ansi.code);
+                len = (col > len) ? col : len;
+            } else if (action == ANSI_CONTROL) {
+                col++;
+                len = (col > len) ? col : len;
+            }
+            if (!ansi_again(&ansi)) {
+                p++;
+            }
+        }
+
+        // The newline can cut a UTF-8 character short too.
+        if (*p && (ansi_feed(&ansi, *p) == ANSI_PRINT)) {
+            col++;
+            len = (col > len) ? col : len;
+        }
+        (void) ansi_again(&ansi);
+
+        if (count == max) {
+            max = max ? max * 2 : 1024;
+            lengths = (unsigned *) realloc(lengths, max * sizeof(unsigned));
+            assert(lengths);
+        }
+        lengths[count++] = len;
+    } while (*p && *(++p));
+
+    // The longest of the lines that will be kept.
+    first = (*height && (count > *height)) ? count - *height : 0;
+    for (i = first; i < count; i++) {
+        if (lengths[i] > *width) {
+            *width = lengths[i];
+        }
+    }
+
+    if (*width == 0) {
+        *width = 1;
+    } else if (*width > SCREEN_MAX_SIZE) {
+        *width = SCREEN_MAX_SIZE;
+    }
+
+    free(lengths);
+}
+
+
+// Pixel row y of a character drawn with a pen that isn't plain.
+static inline __attribute__((always_inline))
+void screen_draw_cell(struct screen_t *screen, unsigned char ch, pen_t *pen, unsigned y, uint8_t *d,
+                      unsigned width, unsigned height) {
+#define UNDERLINE_UP 2      // Pixel rows above the bottom of the cell
+    uint8_t *atlas = (pen->attr & ATTR_BOLD) ? screen->bold : screen->atlas;
+    uint8_t *s = atlas + (ch * height + y) * width;
+    char *glyph = NULL;
+    unsigned i;
+
+    if ((pen->attr & ATTR_UNDERLINE) && (y == height - UNDERLINE_UP)) {
+        memset(d, pen->fg, width);
+        return;
+    }
+
+    // Beyond ASCII, straight from the font and made bold here.
+    if (ch == (unsigned char) SCREEN_UNICODE) {
+        glyph = font_glyph(pen->code) + y * width;
+        for (i = 0; i < width; i++) {
+            d[i] = (glyph[i] || ((pen->attr & ATTR_BOLD) && i && glyph[i - 1])) ? pen->fg : pen->bg;
+        }
+        return;
+    }
+
+    for (i = 0; i < width; i++) {
+        d[i] = (s[i] == SLOT_FG) ? pen->fg : pen->bg;
+    }
+}
+
+
+// Pixel row y of some columns of text row r.  Plain characters are
+// copied straight from the atlas, blurred ones are always plain.
+// Inlined into a copy for each built in font, where the cell size is
+// a constant and each glyph row becomes a few fixed size moves.
+static inline __attribute__((always_inline))
+void screen_draw_sized(struct screen_t *screen, unsigned r, unsigned y, unsigned left, unsigned cols, uint8_t *d,
+                       unsigned width, unsigned height) {
+    unsigned size = width * height;
+    uint8_t *glyphs = screen->atlas + y * width;
+    char *p = screen_text(screen) + (size_t) r * screen->width + left;
+    pen_t *pen = NULL;
+    unsigned c;
+
+    if (screen->cells == NULL) {
+        for (c = 0; c < cols; c++) {
+            memcpy(d, glyphs + (unsigned char) *(p++) * size, width);
+            d += width;
+        }
+        return;
+    }
+
+    pen = screen_pens(screen) + (size_t) r * screen->width + left;
+    for (c = 0; c < cols; c++, p++, pen++, d += width) {
+        if (is_plain(pen) || (*p == '\x7f')) {
+            memcpy(d, glyphs + (unsigned char) *p * size, width);
+        } else {
+            screen_draw_cell(screen, *p, pen, y, d, width, height);
+        }
+    }
+}
+
+
+static void screen_draw_monaco(struct screen_t *screen, unsigned r, unsigned y, unsigned left, unsigned cols, uint8_t *d) {
+    screen_draw_sized(screen, r, y, left, cols, d, FONT_MONACO_WIDTH, FONT_MONACO_HEIGHT);
+}
+
+
+static void screen_draw_8x13(struct screen_t *screen, unsigned r, unsigned y, unsigned left, unsigned cols, uint8_t *d) {
+    screen_draw_sized(screen, r, y, left, cols, d, FONT_8X13_WIDTH, FONT_8X13_HEIGHT);
+}
+
+
+// Any other font, from a file.
+static void screen_draw_any(struct screen_t *screen, unsigned r, unsigned y, unsigned left, unsigned cols, uint8_t *d) {
+    screen_draw_sized(screen, r, y, left, cols, d, font_width(), font_height());
+}
+
+
+// Each glyph, already in the text and background slots, so drawing
+// a character is just a copy of each of its rows.  Blurred text has
+// its own slot.  Bold glyphs are the same, smeared a pixel right.
+// The drawing for the font's cell size is picked here, once a job.
+static void screen_build_atlas(struct screen_t *screen) {
+    unsigned width = font_width();
+    unsigned size = width * font_height();
+    unsigned ch, i;
+    uint8_t fg;
+    uint8_t *d = NULL;
+    uint8_t *b = NULL;
+    char *glyph = NULL;
+
+    if (screen->atlas == NULL) {
+        screen->atlas = (uint8_t *) malloc(256 * size);
+        assert(screen->atlas);
+        screen->bold = (uint8_t *) malloc(256 * size);
+        assert(screen->bold);
+    }
+
+    d = screen->atlas;
+    b = screen->bold;
+    for (ch = 0; ch < 256; ch++) {
+        glyph = font_char_start(ch);
+        fg = (ch == '\x7f') ? SLOT_BLUR : SLOT_FG;
+        for (i = 0; i < size; i++) {
+            *(d++) = glyph[i] ? fg : SLOT_BG;
+            *(b++) = (glyph[i] || ((i % width) && glyph[i - 1])) ? fg : SLOT_BG;
+        }
+    }
+
+    if ((width == FONT_MONACO_WIDTH) && (font_height() == FONT_MONACO_HEIGHT)) {
+        screen->draw_text = screen_draw_monaco;
+    } else if ((width == FONT_8X13_WIDTH) && (font_height() == FONT_8X13_HEIGHT)) {
+        screen->draw_text = screen_draw_8x13;
+    } else {
+        screen->draw_text = screen_draw_any;
+    }
+}
+
+
+// Pixel row y of text row r, only the columns of the view.
+static void screen_text_row(view_t *view, unsigned r, unsigned y, uint8_t *d) {
+    struct screen_t *screen = view->screen;
+    unsigned width = font_width();
+    unsigned height = font_height();
+    unsigned i;
+    band_t *band = NULL;
+
+    if (view->bands == NULL) {
+        screen->draw_text(screen, r, y, view->left, view->cols, d);
+        return;
+    }
+
+    // Whoever gets to a band first draws all of it.
+    band = view->bands + r;
+    pthread_mutex_lock(&band->lock);
+    if (band->pixels == NULL) {
+        band->pixels = (uint8_t *) malloc(width * height * screen->width);
+        assert(band->pixels);
+
+        for (i = 0; i < height; i++) {
+            screen->draw_text(screen, r, i, 0, screen->width, band->pixels + i * screen->width * width);
+        }
+    }
+    pthread_mutex_unlock(&band->lock);
+
+    memcpy(d, band->pixels + (y * screen->width + view->left) * width, view->cols * width);
+}
+
+
+// Produce pixel row y of the image of a view: the text, then the
+// overlays.  The overlays are placed on the whole screen, so a view
+// further down or right sees them shifted.
+static void screen_render_row(void *context, unsigned y, uint8_t *row) {
+    view_t *view = (view_t *) context;
+    unsigned width = font_width();
+    unsigned height = font_height();
+    int bmp_width = width * view->cols + PADDING_LEFT + PADDING_RIGHT;
+    int shift = view->left * width;
+    int left, right;
+    unsigned i, t;
+    overlay_t *o = NULL;
+
+    memset(row, SLOT_BG, bmp_width);
+
+    if ((y >= PADDING_TOP) && (y < PADDING_TOP + height * view->rows)) {
+        screen_text_row(view, view->first + (y - PADDING_TOP) / height, (y - PADDING_TOP) % height, row + PADDING_LEFT);
+    }
+
+    // Each box is thickness outlines, each one a pixel further in, drawn
+    // a line at a time.  Anything past the edges is clipped.
+    y += view->first * height;
+    for (i = 0; i < view->screen->overlay_count; i++) {
+        o = view->screen->overlays + i;
+        if ((y < o->top) || (y > o->bottom)) {
+            continue;
+        }
+
+        for (t = 0; t < o->thickness; t++) {
+            if ((y < o->top + t) || (y > o->bottom - t)) {
+                break;
+            }
+
+            left = (int) (o->left + t) - shift;
+            right = (int) (o->right - t) - shift;
+
+            if ((y == o->top + t) || (y == o->bottom - t)) {
+                if (left < 0) {
+                    left = 0;
+                }
+                if (right >= bmp_width) {
+                    right = bmp_width - 1;
+                }
+                if (left <= right) {
+                    memset(row + left, o->color, right - left + 1);
+                }
+            } else {
+                if ((left >= 0) && (left < bmp_width)) {
+                    row[left] = o->color;
+                }
+                if ((right >= 0) && (right < bmp_width)) {
+                    row[right] = o->color;
+                }
+            }
+        }
+    }
+}
+
+
+// The output format is picked by the file extension, BMP by default.
+static int has_extension(char *filename, char *extension) {
+    char *p = strrchr(filename, '.');
+
+    return((p != NULL) && (strcasecmp(p + 1, extension) == 0));
+}
+
+
+// Formats made straight from the text, without any pixels.
+static int is_vector(char *filename) {
+    return(has_extension(filename, "svg") || has_extension(filename, "html") || has_extension(filename, "htm"));
+}
+
+
+// Let the encoder know which slots to expect.
+static void screen_set_colors(struct screen_t *screen, struct image_t *image) {
+    uint8_t used[256];
+    unsigned i;
+
+    memset(used, false, sizeof(used));
+    used[SLOT_BG] = true;
+    used[SLOT_FG] = true;
+    used[SLOT_BLUR] = screen->did_blur;
+    for (i = 0; i < 256; i++) {
+        used[i] |= screen->pen_slots[i];
+    }
+    for (i = 0; i < screen->overlay_count; i++) {
+        used[screen->overlays[i].color] = true;
+    }
+    bmp_set_colors(image, used);
+}
+
+
+// The image of some rows of the screen, drawn as they are asked for.
+// The atlas has to be built already.
+static struct image_t *screen_view_image(view_t *view) {
+    struct image_t *image = NULL;
+
+    image = bmp_new_rows(font_width() * view->cols + PADDING_LEFT + PADDING_RIGHT,
+                         font_height() * view->rows + PADDING_TOP + PADDING_BOTTOM,
+                         screen_render_row, view);
+    screen_set_colors(view->screen, image);
+
+    return(image);
+}
+
+
+// The image of the whole screen.
+static struct image_t *screen_image(struct screen_t *screen) {
+    screen_build_atlas(screen);
+    screen_settle(screen);
+
+    if (screen->image) {
+        bmp_free(screen->image);
+    }
+
+    screen->view.screen = screen;
+    screen->view.first = 0;
+    screen->view.rows = screen->height;
+    screen->view.left = 0;
+    screen->view.cols = screen->width;
+    screen->view.bands = NULL;
+    screen->image = screen_view_image(&screen->view);
+
+    return(screen->image);
+}
+
+
+// Formats written from the pixels.
+static void screen_write_raster(char *filename, struct image_t *image) {
+    struct gif_t *gif = NULL;
 
-/*
- * When we printf a line, typically it's terminated by a NL character. We
- * don't want to shift the screen up a line if that's the end of the
- * output - otherwise we end up with an empty line at the bottom of
- * the screen.  So we overload the x_pos.  It's -1 to indicate that
- * there is a hidden newline.  Otherwise, it's the x coord of where the
- * next string will go.
- */
+    if (has_extension(filename, "qoi")) {
+        qoi_write_image(filename, image);
+    } else if (has_extension(filename, "gif")) {
+        gif = gif_open(filename, bmp_width(image), bmp_height(image));
+        gif_add_frame(gif, image, 0, 0, bmp_width(image), bmp_height(image), 0);
+        gif_close(gif);
+    } else {
+        bmp_write_image(filename, image);
+    }
+}
 
-struct screen_t {
-    unsigned width;
-    unsigned height;
-    char *chars;        // Characters the user can see
-    struct image_t *image;
-    int x_pos;
-    unsigned did_blur;  // Sometimes we just want blurring, so need to know if we blurred anything
-};
 
+// The whole image as a GIF.  If it's the one being animated, this is
+// the last frame, drawn over all of the starting size since the height
+// may have been trimmed since.
+static void screen_write_gif(struct screen_t *screen, char *filename, struct image_t *image) {
+#define LAST_FRAME_DELAY 300
+    struct gif_t *gif = screen->gif;
+    unsigned height = screen->gif_height;
 
-typedef struct {        // Units in characters, not pixels
-    unsigned exists;
-    unsigned left;
-    unsigned top;
-    unsigned right;
-    unsigned bottom;
-} box_t;
+    if ((gif == NULL) || strcmp(filename, screen->gif_name)) {
+        screen_write_raster(filename, image);
+        return;
+    }
 
+    gif_add_frame(gif, image, 0, 0, bmp_width(image), height, LAST_FRAME_DELAY);
+    gif_close(gif);
+    screen->gif = NULL;
+}
 
-struct screen_t *screen_new(unsigned char_width, unsigned char_height) {
-    struct screen_t *answer = NULL;
-    unsigned amount = char_width * char_height;
-    unsigned bmp_width, bmp_height;
 
-    answer = (struct screen_t *) malloc(sizeof(struct screen_t));
-    assert(answer);
+void screen_write_image(struct screen_t *screen, char *filename) {
+    struct image_t *image = screen_image(screen);
+
+    screen->wrote_bmp = false;
+    if (has_extension(filename, "gif")) {
+        screen_write_gif(screen, filename, image);
+    } else if (has_extension(filename, "svg")) {
+        svg_write_image(filename, screen);
+    } else if (has_extension(filename, "html") || has_extension(filename, "htm")) {
+        html_write_image(filename, screen);
+    } else {
+        screen_write_raster(filename, image);
+        screen->wrote_bmp = !has_extension(filename, "qoi");
+    }
+}
 
-    answer->width = char_width;
-    answer->height = char_height;
 
-    answer->chars = (char *) malloc(amount + 1);
-    assert(answer->chars);
+// Work shared by the threads writing views, each takes the next one
+// not yet written.
+typedef struct {
+    view_t *views;
+    char **names;
+    unsigned count;
+    unsigned next;
+    pthread_mutex_t lock;
+} views_job_t;
 
-    memset(answer->chars, ' ', amount);
-    answer->chars[amount] = '\0';                   // Will make searching easier latter
 
-    bmp_width = font_width() * char_width + PADDING_LEFT + PADDING_RIGHT;
-    bmp_height = font_height() * char_height + PADDING_TOP + PADDING_BOTTOM;
-    answer->image = bmp_new(bmp_width, bmp_height);
-    //bmp_draw_box(answer->image, PADDING_TOP - 1, PADDING_LEFT - 1, bmp_width - PADDING_RIGHT, bmp_height - PADDING_BOTTOM, color_name_to_id("black"), 1);      // background, 1 pixel
+// A file next to the output, i.e. out-001.bmp or out-pages.txt for
+// out.bmp.  The extension is kept when NULL.  Caller frees.
+static char *screen_sibling_name(char *filename, char *tag, char *extension) {
+    char *dot = strrchr(filename, '.');
+    unsigned base = dot ? dot - filename : strlen(filename);
+    char *answer = NULL;
 
-    answer->x_pos = -1;
-    answer->did_blur = false;
+    if (extension == NULL) {
+        extension = dot ? dot + 1 : "";
+    }
+
+    answer = (char *) malloc(base + strlen(tag) + strlen(extension) + 3);
+    assert(answer);
+    sprintf(answer, "%.*s-%s%s%s", base, filename, tag, *extension ? "." : "", extension);
 
     return(answer);
 }
 
 
-// Place character ch at screen location x (width), y (height).
-void screen_char(struct screen_t *screen, unsigned char ch, unsigned x, unsigned y) {
-    assert(x < screen->width);
-    assert(y < screen->height);
-    screen->chars[y * screen->width + x] = ch;
-    screen_draw_character(screen, ch, x, y);
+static char *screen_page_name(char *filename, unsigned page) {
+    char tag[16];
+
+    sprintf(tag, "%03u", page);
+    return(screen_sibling_name(filename, tag, NULL));
 }
 
 
-static void screen_move_up(struct screen_t *screen) {
-    char *dst = screen->chars;
-    char *src = dst + screen->width;
-    unsigned x;
+static void *screen_views_worker(void *context) {
+    views_job_t *job = (views_job_t *) context;
+    struct image_t *image = NULL;
+    unsigned i;
 
-    memmove(dst, src, (screen->width * (screen->height - 1)));
+    while (true) {
+        pthread_mutex_lock(&job->lock);
+        i = job->next++;
+        pthread_mutex_unlock(&job->lock);
 
-    // Move the BMP image up, it will use background color for fill
-    bmp_move_up(screen->image, PADDING_TOP, PADDING_TOP + font_height(), (screen->height - 1) * font_height());
+        if (i >= job->count) {
+            break;
+        }
 
-    // Now an empty line at the end.  This also draws the image content.
-    for (x = 0; x < screen->width; x++) {
-        screen_char(screen, ' ', x, screen->height - 1);
+        image = screen_view_image(job->views + i);
+        screen_write_raster(job->names[i], image);
+        bmp_free(image);
     }
+
+    return(NULL);
 }
 
 
-void screen_printf(struct screen_t *screen, char *string) {
-    unsigned row = screen->height - 1;
+// Make the glyphs of every character beyond ASCII, while there's just
+// the one thread.
+static void screen_load_glyphs(struct screen_t *screen) {
+    char *text = screen_text(screen);
+    size_t amount = (size_t) screen->width * screen->height;
+    char *p = text;
 
-    // If we had a leftover newline, handle it by shifting screen and bitmap
-    while (*string) {
-        if (screen->x_pos == -1) {
-            screen_move_up(screen);
-            screen->x_pos = 0;
+    if (screen->cells == NULL) {
+        return;
+    }
+
+    while ((p = memchr(p, SCREEN_UNICODE, amount - (p - text))) != NULL) {
+        (void) font_glyph(screen_pens(screen)[p - text].code);
+        p++;
+    }
+}
+
+
+// Write each view to its file, one thread per processor.
+static void screen_write_views(struct screen_t *screen, view_t *views, char **names, unsigned count) {
+#define MAX_THREADS 64
+    pthread_t threads[MAX_THREADS];
+    views_job_t job;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned i, threads_count;
+
+    screen_build_atlas(screen);
+    screen_load_glyphs(screen);
+    screen->wrote_bmp = false;
+
+    job.views = views;
+    job.names = names;
+    job.count = count;
+    job.next = 0;
+    pthread_mutex_init(&job.lock, NULL);
+
+    threads_count = (cpus > 0) ? cpus : 1;
+    if (threads_count > MAX_THREADS) {
+        threads_count = MAX_THREADS;
+    }
+    if (threads_count > count) {
+        threads_count = count;
+    }
+
+    for (i = 0; i < threads_count; i++) {
+        if (pthread_create(threads + i, NULL, screen_views_worker, &job)) {
+            fprintf(stderr, "Unable to start a thread\n");
+            exit(EXIT_FAILURE);
         }
+    }
+    for (i = 0; i < threads_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
 
-        if (*string == '\n') {
-            screen->x_pos = -1;
-        } else if (*string == '') {
-            char *p = NULL;
-
-            // Do nothing with the escape.
-            // If it's an ANSII color, silently consume it:   <ESC>[#m
-            // Where # may be numbers separated by semicolons
-            // This cheap regex will consume <ESC>[0-9\[;]*m
-            p = string + 1;
-            while ((*p == ';') || (*p == '[') || ((*p >= '0') && (*p <= '9'))) {
-                p++;
-            }
+    pthread_mutex_destroy(&job.lock);
+}
 
-            if (*p == 'm') {
-                string = p;         // Point at final 'm', which will be skipped
-            }
-        } else {
-            screen_char(screen, *string, screen->x_pos++, row);
 
-            // Hit end of line?  Wrap around and keep going.
-            if (screen->x_pos == screen->width) {
-                screen_move_up(screen);
-                screen->x_pos = 0;
+void screen_write_pages(struct screen_t *screen, char *filename, unsigned page_rows) {
+    unsigned pages, i, m, last, found;
+    view_t *views = NULL;
+    char **names = NULL;
+    char *name = NULL;
+    FILE *fp = NULL;
+
+    if (is_vector(filename)) {
+        fprintf(stderr, "Pages are written as BMP, QOI or GIF only\n");
+        exit(EXIT_FAILURE);
+    }
+
+    screen_settle(screen);
+    pages = (screen->height + page_rows - 1) / page_rows;
+
+    views = (view_t *) malloc(pages * sizeof(view_t));
+    names = (char **) malloc(pages * sizeof(char *));
+    assert(views && names);
+
+    for (i = 0; i < pages; i++) {
+        views[i].screen = screen;
+        views[i].first = i * page_rows;
+        views[i].rows = screen->height - views[i].first;
+        if (views[i].rows > page_rows) {
+            views[i].rows = page_rows;
+        }
+        views[i].left = 0;
+        views[i].cols = screen->width;
+        views[i].bands = NULL;
+        names[i] = screen_page_name(filename, i + 1);
+    }
+
+    screen_write_views(screen, views, names, pages);
+
+    // The manifest: each page, its rows and how many matches start there.
+    name = screen_sibling_name(filename, "pages", "txt");
+    fp = fopen(name, "w");
+    assert(fp);
+    free(name);
+
+    fprintf(fp, "# page\tfirst row\tlast row\tmatches\n");
+    for (i = 0; i < pages; i++) {
+        last = views[i].first + views[i].rows - 1;
+
+        found = 0;
+        for (m = 0; m < screen->match_count; m++) {
+            if ((screen->matches[m].row >= views[i].first) && (screen->matches[m].row <= last)) {
+                found++;
             }
         }
 
-        string++;
+        fprintf(fp, "%s\t%u\t%u\t%u\n", names[i], views[i].first + 1, last + 1, found);
+        free(names[i]);
     }
+
+    fclose(fp);
+    free(views);
+    free(names);
 }
 
 
-void screen_write_image(struct screen_t *screen, char *filename) {
-    bmp_write_image(filename, screen->image);
+void screen_write_snippets(struct screen_t *screen, char *filename, unsigned context) {
+    unsigned count = screen->match_count;
+    unsigned i, r, c, end, last, left, right;
+    view_t *views = NULL;
+    char **names = NULL;
+    band_t *bands = NULL;
+    match_t *m = NULL;
+    char *p = NULL;
+    char tag[32];
+
+    if (is_vector(filename)) {
+        fprintf(stderr, "Snippets are written as BMP, QOI or GIF only\n");
+        exit(EXIT_FAILURE);
+    }
+
+    screen_settle(screen);
+
+    if (count == 0) {
+        return;
+    }
+
+    views = (view_t *) malloc(count * sizeof(view_t));
+    names = (char **) malloc(count * sizeof(char *));
+    bands = (band_t *) malloc(screen->height * sizeof(band_t));
+    assert(views && names && bands);
+
+    for (r = 0; r < screen->height; r++) {
+        pthread_mutex_init(&bands[r].lock, NULL);
+        bands[r].pixels = NULL;
+    }
+
+    for (i = 0; i < count; i++) {
+        m = screen->matches + i;
+
+        // The match may run onto the next row.
+        end = ((size_t) m->row * screen->width + m->col + m->len - 1) / screen->width;
+        views[i].first = (m->row > context) ? m->row - context : 0;
+        last = end + context;
+        if (last >= screen->height) {
+            last = screen->height - 1;
+        }
+        views[i].rows = last - views[i].first + 1;
+
+        // Columns from the first to the last character in use, and
+        // always all of the match.
+        left = m->col;
+        right = (end > m->row) ? screen->width - 1 : m->col + m->len - 1;
+        for (r = views[i].first; r <= last; r++) {
+            p = screen_text(screen) + (size_t) r * screen->width;
+            for (c = 0; (c < left) && (p[c] == ' '); c++)
+                ;
+            left = c;
+            for (c = screen->width - 1; (c > right) && (p[c] == ' '); c--)
+                ;
+            right = c;
+        }
+
+        views[i].screen = screen;
+        views[i].left = left;
+        views[i].cols = right - left + 1;
+        views[i].bands = bands;
+
+        sprintf(tag, "match-%03u", i + 1);
+        names[i] = screen_sibling_name(filename, tag, NULL);
+    }
+
+    screen_write_views(screen, views, names, count);
+
+    for (i = 0; i < count; i++) {
+        free(names[i]);
+    }
+    for (r = 0; r < screen->height; r++) {
+        pthread_mutex_destroy(&bands[r].lock);
+        free(bands[r].pixels);
+    }
+    free(views);
+    free(names);
+    free(bands);
+}
+
+
+void screen_preview(struct screen_t *screen, unsigned preview) {
+    preview_write_image(screen_image(screen), preview);
+}
+
+
+void screen_write_theme(struct screen_t *screen, char *filename) {
+    // A BMP only needs a new color table, anything else is redone.
+    if (screen->wrote_bmp && !is_vector(filename) && !has_extension(filename, "qoi") && !has_extension(filename, "gif")) {
+        bmp_write_theme(filename, screen->image);
+    } else {
+        screen_write_image(screen, filename);
+    }
+}
+
+
+// Has column c of row r changed since the last frame?
+static int screen_changed(struct screen_t *screen, unsigned r, unsigned c) {
+    size_t i = (size_t) r * screen->width + c;
+    pen_t plain;
+    pen_t *now = &plain;
+    pen_t *then = screen->shot_pens + i;
+
+    if (screen_text(screen)[i] != screen->shot[i]) {
+        return(true);
+    }
+
+    ansi_default_pen(&plain);
+    if (screen->cells) {
+        now = screen_pens(screen) + i;
+    }
+
+    // Beyond ASCII, every character has the same stand in.
+    return((now->fg != then->fg) || (now->bg != then->bg) || (now->attr != then->attr) ||
+           (now->code != then->code));
+}
+
+
+// Row r as it is now goes into the shot.
+static void screen_shoot_row(struct screen_t *screen, unsigned r) {
+    size_t i = (size_t) r * screen->width;
+
+    memcpy(screen->shot + i, screen_text(screen) + i, screen->width);
+    if (screen->cells) {
+        memcpy(screen->shot_pens + i, screen_pens(screen) + i, screen->width * sizeof(pen_t));
+    } else {
+        screen_plain_pens(screen->shot_pens + i, screen->width);
+    }
+}
+
+
+unsigned screen_animate(struct screen_t *screen, char *filename) {
+    struct image_t *image = NULL;
+    size_t amount = (size_t) screen->width * screen->height;
+    unsigned r;
+
+    if (!has_extension(filename, "gif")) {
+        return(false);
+    }
+
+    screen->shot = (char *) malloc(amount);
+    assert(screen->shot);
+    screen->shot_pens = (pen_t *) malloc(amount * sizeof(pen_t));
+    assert(screen->shot_pens);
+    screen->dirty = (uint8_t *) calloc(screen->height, 1);
+    assert(screen->dirty);
+    for (r = 0; r < screen->height; r++) {
+        screen_shoot_row(screen, r);
+    }
+
+    // Start with the whole, empty, screen.
+    image = screen_image(screen);
+    screen->gif = gif_open(filename, bmp_width(image), bmp_height(image));
+    screen->gif_name = filename;
+    screen->gif_height = bmp_height(image);
+    gif_add_frame(screen->gif, image, 0, 0, bmp_width(image), bmp_height(image), 0);
+
+    return(true);
+}
+
+
+// Only rows written to since the last frame can differ, anything
+// else isn't looked at.
+void screen_add_frame(struct screen_t *screen) {
+#define FRAME_DELAY 10
+    unsigned width = font_width();
+    unsigned height = font_height();
+    unsigned top = screen->height;
+    unsigned bottom = 0;
+    unsigned left = screen->width;
+    unsigned right = 0;
+    unsigned r, c;
+
+    if (screen->gif == NULL) {
+        return;
+    }
+
+    for (r = 0; r < screen->height; r++) {
+        if (!screen->dirty[r]) {
+            continue;
+        }
+        screen->dirty[r] = false;
+
+        for (c = 0; (c < screen->width) && !screen_changed(screen, r, c); c++)
+            ;
+        if (c == screen->width) {
+            continue;
+        }
+        if (c < left) {
+            left = c;
+        }
+
+        for (c = screen->width - 1; !screen_changed(screen, r, c); c--)
+            ;
+        if (c > right) {
+            right = c;
+        }
+
+        if (r < top) {
+            top = r;
+        }
+        bottom = r;
+        screen_shoot_row(screen, r);
+    }
+
+    if (top > bottom) {
+        return;
+    }
+
+    // The atlas and image made when the animation started are kept,
+    // only colors that have shown up since are new.
+    screen_set_colors(screen, screen->image);
+    gif_add_frame(screen->gif, screen->image,
+                  PADDING_LEFT + left * width, PADDING_TOP + top * height,
+                  (right - left + 1) * width, (bottom - top + 1) * height, FRAME_DELAY);
+}
+
+
+void screen_cancel_animation(struct screen_t *screen) {
+    if (screen->gif) {
+        gif_close(screen->gif);
+        screen->gif = NULL;
+        remove(screen->gif_name);
+    }
 }
 
 
@@ -150,51 +2022,61 @@ void screen_draw_box(struct screen_t *screen, unsigned char_left, unsigned char_
     right = (char_right + 1) * width + PADDING_LEFT + AWAY - 2;
     bottom = (char_bottom + 1) * height + PADDING_TOP + AWAY - 2;
 
-    bmp_draw_box(screen->image, top, left, right, bottom, color, THICKNESS);
+    screen_add_overlay(screen, top, left, right, bottom, color_slot(color), THICKNESS);
 }
 
 
-void screen_draw_character(struct screen_t *screen, unsigned char ch, unsigned x, unsigned y) {
-    char *glyph = font_char_start(ch);
-    unsigned i, j, color;
-    unsigned width = font_width();
-    unsigned height = font_height();
+// Row r only says how many rows were left out around it.
+static int screen_is_omitted(struct screen_t *screen, unsigned r) {
+    return((screen->omitted != NULL) && screen->omitted[screen->top + r]);
+}
 
-    x *= width;
-    x += PADDING_LEFT;
 
-    y *= height;
-    y += PADDING_TOP;
+// The next place string is found from content on, skipping any rows
+// that only say how many were left out.
+static char *screen_find(struct screen_t *screen, char *content, char *string, unsigned wantInsensitive) {
+    char *text = screen_text(screen);
+    char *found = NULL;
+    size_t len = strlen(string);
+
+    while (*content) {
+        if (wantInsensitive == true) {
+            found = strcasestr(content, string);
+        } else {
+            found = strstr(content, string);
+        }
+        if (found == NULL) {
+            return(NULL);
+        }
 
-    // x and y are now starting bit positions in the image
-    for (i = 0; i < height; i++) {
-        for (j = 0; j < width; j++) {
-            color = (*glyph == 0) ? color_bg() : color_fg();
-            bmp_set_bit(screen->image, x + j, y + i, color);
-            glyph++;
+        if (!screen_is_omitted(screen, (found - text) / screen->width) &&
+            !screen_is_omitted(screen, (found + len - 1 - text) / screen->width)) {
+            return(found);
         }
-     }
+        content = found + 1;
+    }
+
+    return(NULL);
 }
 
 
 void screen_blur(struct screen_t *screen, char *string, unsigned wantInsensitive) {
     unsigned blur_column;
-    char *content = screen->chars;
+    char *content = NULL;
     char *p = NULL;
-    unsigned offset, r, c;
+    size_t offset;
+    unsigned r, c;
 
-    if (wantInsensitive == true) {
-        p = strcasestr(content, string);
-    } else {
-        p = strstr(content, string);
-    }
+    screen_settle(screen);
+    content = screen_text(screen);
+    p = screen_find(screen, content, string, wantInsensitive);
 
     // It's not an error to not find anything to blur
     if (!p) {
         return;
     }
 
-    offset = p - screen->chars;
+    offset = p - screen_text(screen);
     r = offset / screen->width;
     c = offset % screen->width;
 
@@ -203,14 +2085,16 @@ void screen_blur(struct screen_t *screen, char *string, unsigned wantInsensitive
     // Starting in the next row, blur any non-space characters found in 
     // the blur_column to the end of the line.
     while (++r < screen->height) {
-        offset = r * screen->width + blur_column;
+        if (screen_is_omitted(screen, r)) {
+            continue;
+        }
+        offset = (size_t) r * screen->width + blur_column;
         c = blur_column;
 
         p = content + offset;
         while (c < screen->width) {
             if (*p != ' ') {
                 *p = '\x7f';        // DEL character, still 7 bits
-                screen_draw_character(screen, '\x7f', c, r);
                 screen->did_blur = true;
             }
             p++;
@@ -231,7 +2115,7 @@ static void screen_greedy_expand(struct screen_t *screen, char **found, unsigned
     }
 
     // Get the starting column
-    c = (*found - screen->chars) % screen->width;
+    c = (*found - screen_text(screen)) % screen->width;
 
     // Expand before the start of the string, but not too far.
     p = *found;
@@ -262,7 +2146,7 @@ static void screen_greedy_expand(struct screen_t *screen, char **found, unsigned
     }
 
     // Get the end of the string
-    c = ((*found - screen->chars) % screen->width) + *len;
+    c = ((*found - screen_text(screen)) % screen->width) + *len;
     p = *found + *len;
     while (c++ < screen->width) {               // c is column just after string
         ch = *(p++);
@@ -295,6 +2179,22 @@ unsigned screen_did_blur(struct screen_t *screen) {
 }
 
 
+static void screen_add_match(struct screen_t *screen, unsigned row, unsigned col, unsigned len) {
+    match_t *m = NULL;
+
+    if (screen->match_count == screen->match_max) {
+        screen->match_max = screen->match_max ? screen->match_max * 2 : 16;
+        screen->matches = (match_t *) realloc(screen->matches, screen->match_max * sizeof(match_t));
+        assert(screen->matches);
+    }
+
+    m = screen->matches + screen->match_count++;
+    m->row = row;
+    m->col = col;
+    m->len = len;
+}
+
+
 // Scan top down, look for boxes that can be drawn.
 // Up to N boxes per line can exist at once, for widely separated boxes.
 // A box isn't drawn until we are sure of the final boundaries.
@@ -302,21 +2202,21 @@ unsigned screen_did_blur(struct screen_t *screen) {
 unsigned screen_search(struct screen_t *screen, char *string, unsigned color, unsigned wantInsensitive, unsigned greedy_level) {
 #define MAXBOX 7
     box_t box[MAXBOX];
-    char *content = screen->chars;
+    char *content = NULL;
     char *found = NULL;
     unsigned extend;
-    unsigned i, len, offset, r, c, test, count = 0;
+    size_t offset;
+    unsigned i, len, r, c, test, count = 0;
+
+    screen_settle(screen);
+    content = screen_text(screen);
 
     for (i = 0; i < MAXBOX; i++) {
         box[i].exists = false;
     }
 
     while (*content) {
-        if (wantInsensitive == true) {
-            found = strcasestr(content, string);
-        } else {
-            found = strstr(content, string);
-        }
+        found = screen_find(screen, content, string, wantInsensitive);
         if (!found) break;
 
         count++;
@@ -326,9 +2226,10 @@ unsigned screen_search(struct screen_t *screen, char *string, unsigned color, un
         screen_greedy_expand(screen, &found, &len, greedy_level);
 
         // Get the row and column of the start of this entry.
-        offset = found - screen->chars;
+        offset = found - screen_text(screen);
         r = offset / screen->width;
         c = offset % screen->width;
+        screen_add_match(screen, r, c, len);
 
         // Close off any previous boxes.
         for (i = 0; i < MAXBOX; i++) {
@@ -403,105 +2304,170 @@ unsigned screen_search(struct screen_t *screen, char *string, unsigned color, un
 }
 
 
-// Adjust the screen content based on the desired context.
-// Phase 1: Find first match, shift screen up as needed.
-// Phase 2: Find last match, truncate the screen and bmp file to 
-//          right size (will also redo the implicit border)
-void screen_fix_context(struct screen_t *screen, char *string, unsigned wantInsensitive, unsigned context) {
-    char *content = screen->chars;
-    char *prev = NULL;
-    char *found = NULL;
-    unsigned offset, r;
-
-    // Phase 1
-    if (g_verbose > 2) {
-        fprintf(stderr, "%s:%u starting phase 1\n", __FILE__, __LINE__);
-    }
-
-    if (wantInsensitive == true) {
-        found = strcasestr(content, string);
-    } else {
-        found = strstr(content, string);
-    }
+// A row standing in for the rows taken out between two matches.
+static void screen_omitted_row(char *row, unsigned width, unsigned count) {
+    char text[64];
+    unsigned len;
 
-    // It's not an error if we didn't find the string.
-    if (found == NULL) {
-       return;
+    len = snprintf(text, sizeof(text), "... %u lines omitted ...", count);
+    if (len > width) {
+        len = width;
     }
 
-    // Regardless of the greedy level, we won't change rows.
-
-    // Get the row of the entry.
-    offset = found - screen->chars;
-    r = offset / screen->width;
-
-    if (g_verbose > 2) {
-        fprintf(stderr, "%s:%u offset: %u, r: %u\n", __FILE__, __LINE__, offset, r);
-    }
+    memset(row, ' ', width);
+    memcpy(row, text, len);
+}
 
-    // If we have too many rows at the top, shift the screen up
-    while (r-- > context) {
-        screen_printf(screen, "\n");
-    }
 
-    // Phase 2, there's no backward str[case]str
-    if (g_verbose > 2) {
-        fprintf(stderr, "%s:%u starting phase 2\n", __FILE__, __LINE__);
-    }
-    prev = NULL;
-    content = screen->chars;        // Have to start over
+// Adjust the screen content based on the desired context, like grep
+// does: only rows within context of a match are kept.  Each gap is a
+// single row saying how many were left out, while anything above the
+// first or below the last match just goes.  The text is rebuilt from
+// the kept rows, so nothing else ever sees the others.  The rows saying
+// how many were left out are marked, so they're never searched or blurred.
+void screen_fix_context(struct screen_t *screen, char *string, unsigned wantInsensitive, unsigned context) {
+    char *content = NULL;
+    char *found = NULL;
+    char *text = NULL;
+    char *chars = NULL;
+    char *d = NULL;
+    pen_t *pens = NULL;
+    pen_t *cells = NULL;
+    uint8_t *keep = NULL;
+    uint8_t *omitted = NULL;
+    size_t offset;
+    unsigned first, last, r, rows, gap;
+
+    screen_settle(screen);
+    text = screen_text(screen);
+
+    keep = (uint8_t *) calloc(screen->height, 1);
+    assert(keep);
+
+    // Mark the rows around each match, wherever it is.
+    content = text;
     while (*content) {
         if (wantInsensitive == true) {
             found = strcasestr(content, string);
         } else {
             found = strstr(content, string);
         }
-        
-        // Scan until we can't find any more.
+
         if (found == NULL) {
             break;
-        } else {
-            prev = found;
         }
 
-        // Don't need to worry about greedy level here.
-        content = found + 1;
-    }
+        // Regardless of the greedy level, we won't change rows.
+        offset = found - text;
+        first = offset / screen->width;
+        last = (offset + strlen(string) - 1) / screen->width;
 
-    // We should have found our first value no matter what.
-    assert(prev);
+        first = (first > context) ? first - context : 0;
+        last += context;
+        if (last >= screen->height) {
+            last = screen->height - 1;
+        }
 
-    // Get the row of the entry.
-    offset = prev - screen->chars;
-    r = offset / screen->width;
+        memset(keep + first, true, last - first + 1);
 
-    if (g_verbose > 2) {
-        fprintf(stderr, "%s:%u offset: %u, r: %u\n", __FILE__, __LINE__, offset, r);
+        if (g_verbose > 2) {
+            fprintf(stderr, "%s:%u offset: %zu, rows: %u-%u\n", __FILE__, __LINE__, offset, first, last);
+        }
+
+        content = found + 1;
     }
 
-    // This will be the last row
-    r += context;
-    if (r > screen->height) {
+    // It's not an error if we didn't find the string.
+    for (first = 0; (first < screen->height) && !keep[first]; first++)
+        ;
+    if (first == screen->height) {
+        free(keep);
         return;
     }
+    for (last = screen->height - 1; !keep[last]; last--)
+        ;
+
+    // Rows in the result, a single row left out may as well stay.
+    rows = 0;
+    gap = 0;
+    for (r = first; r <= last; r++) {
+        if (keep[r]) {
+            rows += (gap > 1) ? 2 : gap + 1;
+            gap = 0;
+        } else {
+            gap++;
+        }
+    }
+
+    chars = (char *) malloc((size_t) rows * screen->width + 1);
+    assert(chars);
+    if (screen->cells) {
+        pens = screen_pens(screen);
+        cells = (pen_t *) malloc((size_t) rows * screen->width * sizeof(pen_t));
+        assert(cells);
+    }
+    omitted = (uint8_t *) calloc(rows, 1);
+    assert(omitted);
+
+    d = chars;
+    gap = 0;
+    for (r = first; r <= last; r++) {
+        if (!keep[r]) {
+            gap++;
+            continue;
+        }
 
-    // Adjust the screen height.  We don't need to reallocate memory.
-    screen->height = r + 1;
+        if (gap > 1) {
+            screen_omitted_row(d, screen->width, gap);
+            omitted[(d - chars) / screen->width] = true;
+            if (cells) {
+                screen_plain_pens(cells + (d - chars), screen->width);
+            }
+            d += screen->width;
+        } else if (gap == 1) {
+            memcpy(d, text + (size_t) (r - 1) * screen->width, screen->width);
+            if (cells) {
+                memcpy(cells + (d - chars), pens + (size_t) (r - 1) * screen->width, screen->width * sizeof(pen_t));
+            }
+            d += screen->width;
+        }
+        gap = 0;
 
-    // The adjusting of the bitmap will be later
+        memcpy(d, text + (size_t) r * screen->width, screen->width);
+        if (cells) {
+            memcpy(cells + (d - chars), pens + (size_t) r * screen->width, screen->width * sizeof(pen_t));
+        }
+        d += screen->width;
+    }
+    *d = '\0';
+
+    free(screen->chars);
+    free(screen->cells);
+    free(screen->omitted);
+    free(keep);
+    screen->chars = chars;
+    screen->cells = cells;
+    screen->omitted = omitted;
+    screen->top = 0;
+    screen->height = rows;
 }
 
 
-// Return true if the given row is blank
+// Return true if the given row is blank, spaces on a colored
+// background still show.
 static int row_is_blank(struct screen_t *screen, unsigned row) {
     unsigned i;
-    char *p = screen->chars;
+    char *p = screen_text(screen);
+    pen_t *pen = screen->cells ? screen_pens(screen) + (size_t) row * screen->width : NULL;
 
-    p += row * screen->width;
+    p += (size_t) row * screen->width;
     for (i = 0; i < screen->width; i++) {
         if (*(p++) != ' ') {
             return(false);
         }
+        if (pen && ((pen++)->bg != SLOT_BG)) {
+            return(false);
+        }
     }
 
     return(true);
@@ -509,41 +2475,33 @@ static int row_is_blank(struct screen_t *screen, unsigned row) {
 
 
 void screen_fix_blanklines(struct screen_t *screen) {
-    unsigned bmp_height, bmp_width;
-    unsigned row = screen->height;
-
-    // For any blank rows, shift the screen up, just not too far
-    while (row > 0) {
-        if (row_is_blank(screen, 0) == true) {
-            screen_printf(screen, "\n");
-            row--;
-        } else {
-            break;
-        }
+    unsigned bmp_height, bmp_width, row;
+
+    screen_settle(screen);
+
+    // For any blank rows at the top, move the view down, just not too far
+    row = 0;
+    while ((row < screen->height - 1) && row_is_blank(screen, row)) {
+        row++;
     }
+    screen_set_view(screen, row, screen->height - row);
 
     // Starting at the bottom, work backwards to the first non-blank
     // row, or the first line of the display.
-    row = screen->height;
-
-    while (row > 1) {
+    row = screen->height - 1;
+    while ((row > 0) && row_is_blank(screen, row)) {
         row--;
-        if (row_is_blank(screen, row) == false) {
-            break;
-        }
     }
 
-    screen->height = row + 1;
+    screen_set_view(screen, 0, row + 1);
 
-    // Tell BMP to readjust the height and redraw the border.
+    // The image follows the new height, draw the border around it.
     bmp_height = font_height() * screen->height + PADDING_TOP + PADDING_BOTTOM;
     if (g_verbose > 2) {
         fprintf(stderr, "%s:%u new bmp_height %u\n", __FILE__, __LINE__, bmp_height);
     }
-    bmp_shrink_height(screen->image, bmp_height);
 
     bmp_width = font_width() * screen->width + PADDING_LEFT + PADDING_RIGHT;
 
-    // Redraw the border
-    bmp_draw_box(screen->image, 0, 0, bmp_width - 1, bmp_height - 1, color_name_to_id("black"), 2);      // black border
+    screen_add_overlay(screen, 0, 0, bmp_width - 1, bmp_height - 1, SLOT_BORDER, 2);      // black border
 }
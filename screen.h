@@ -7,11 +7,61 @@
 
 typedef struct screen_t screen_dummy;
 
+// Will have to tinker with these to find a good setting.
+#define PADDING_TOP    5
+#define PADDING_LEFT   5
+#define PADDING_RIGHT  5
+#define PADDING_BOTTOM 5
 
-// Create a new virtual screen of width and heigh in characters
+// Largest width or height in characters, the image still fits in a BMP.
+#define SCREEN_MAX_SIZE 65535
+
+
+typedef struct {        // Units in pixels, drawn on top of the text
+    unsigned top;
+    unsigned left;
+    unsigned right;
+    unsigned bottom;
+    unsigned color;     // A color slot
+    unsigned thickness;
+} overlay_t;
+
+
+typedef struct {        // Units in characters
+    unsigned row;
+    unsigned col;
+    unsigned len;
+} match_t;
+
+
+// Create a new virtual screen of width and heigh in characters.  With a
+// height of 0, every line is kept and the height is however many came in.
 struct screen_t *screen_new(unsigned char_width, unsigned char_height);
 
 
+// Size in characters
+unsigned screen_width(struct screen_t *screen);
+unsigned screen_height(struct screen_t *screen);
+
+// Stand ins in a row for what isn't ASCII
+#define SCREEN_UNICODE    '\x80'       // A character beyond ASCII
+#define SCREEN_WIDE_RIGHT '\x81'       // Second column of a wide character
+
+// The characters of a row, not NUL terminated.  Blurred characters are '\x7f'.
+char *screen_row(struct screen_t *screen, unsigned row);
+
+// The character a SCREEN_UNICODE stand in at column c of a row is for,
+// ready to be written out as text.  The noncharacters U+FFFE and U+FFFF
+// of any plane, which XML doesn't allow, come back as U+FFFD.
+unsigned screen_code(struct screen_t *screen, unsigned row, unsigned c);
+
+// The boxes and border drawn over the text, in drawing order.
+overlay_t *screen_overlays(struct screen_t *screen, unsigned *count);
+
+// Everything screen_search() found, top down.
+match_t *screen_matches(struct screen_t *screen, unsigned *count);
+
+
 // Place character ch at screen location x (width), y (height).
 void screen_char(struct screen_t *screen, unsigned char ch, unsigned x, unsigned y);
 
@@ -21,16 +71,57 @@ void screen_char(struct screen_t *screen, unsigned char ch, unsigned x, unsigned
 void screen_printf(struct screen_t *screen, char *string);
 
 
-// Create a BMP file of the resulting image.
+// The width that fits the text exactly, ANSI colors not counted: the
+// longest of the last height lines, or of all of them if height is 0.
+// Tabs go to the next multiple of tab_size.
+void screen_measure(char *text, unsigned tab_size, unsigned *width, unsigned *height);
+
+// Tab stops every tab_size columns, 8 to start with.
+void screen_set_tabs(struct screen_t *screen, unsigned tab_size);
+
+
+// Create an image file of the result.  The extension picks the format:
+// .svg for SVG, .html for HTML, .qoi for QOI, .gif for GIF, otherwise BMP.
 void screen_write_image(struct screen_t *screen, char *filename);
 
 
-// Create a box on the screen around the chosen characters and using the given color.
-void screen_draw_box(struct screen_t *screen, unsigned char_left, unsigned char_top, unsigned char_right, unsigned char_bottom, unsigned color);
+// Split the image into pages of page_rows rows, written at the same time
+// as out-001.bmp, out-002.bmp, ... for out.bmp.  Boxes across a page
+// break are continued on the next page.  out-pages.txt lists the rows
+// and the number of matches on each page.
+void screen_write_pages(struct screen_t *screen, char *filename, unsigned page_rows);
+
+
+// One tightly cropped image per match: its row with context rows above
+// and below, and only the columns in use.  Written at the same time as
+// out-match-001.bmp, out-match-002.bmp, ... for out.bmp.
+void screen_write_snippets(struct screen_t *screen, char *filename, unsigned context);
+
+
+// Show the image in the terminal, see preview.h
+void screen_preview(struct screen_t *screen, unsigned preview);
+
 
+// Write the last image again with the current colors (i.e. after
+// color_swap_theme()).  For a BMP, only the color table is redone.
+void screen_write_theme(struct screen_t *screen, char *filename);
 
-// Place a character at a given location directly on the screen.
-void screen_draw_character(struct screen_t *screen, unsigned char ch, unsigned x, unsigned y);
+
+// Record an animated GIF as the text comes in, if the file name ends in
+// .gif.  Returns false otherwise.  Each frame after the first covers
+// only what changed, and screen_write_image() to the same file adds the
+// final frame and finishes it.
+unsigned screen_animate(struct screen_t *screen, char *filename);
+
+// Add a frame with the screen as it is now.
+void screen_add_frame(struct screen_t *screen);
+
+// Nothing to show after all, remove the animation.
+void screen_cancel_animation(struct screen_t *screen);
+
+
+// Create a box on the screen around the chosen characters and using the given color.
+void screen_draw_box(struct screen_t *screen, unsigned char_left, unsigned char_top, unsigned char_right, unsigned char_bottom, unsigned color);
 
 
 // Locate the blur string and then blur everything in the same column below and to the right of that.
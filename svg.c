@@ -0,0 +1,141 @@
+#include "types.h"
+#include "color.h"
+#include "font.h"
+#include "screen.h"
+#include "svg.h"
+
+// Where the baseline sits in a character cell, and the font size, for
+// a cell height.  17 and 19 for monaco.  The exact advance comes from
+// textLength, so any monospaced font lines up.
+#define SVG_BASELINE(height)  ((height) * 3 / 4)
+#define SVG_FONT_SIZE(height) ((height) * 5 / 6)
+
+
+static void svg_color(FILE *fp, char *attribute, unsigned slot) {
+    unsigned r, g, b;
+
+    color_slot_to_rgb(slot, &r, &g, &b);
+    fprintf(fp, " %s=\"#%02x%02x%02x\"", attribute, r, g, b);
+}
+
+
+// Columns start up to end of row r, escaped for XML.  Characters beyond
+// ASCII are numeric references, each once however many columns it
+// takes.  Anything else the font can't draw is a space, same as the
+// bitmap.
+static void svg_text(FILE *fp, struct screen_t *screen, unsigned r, unsigned start, unsigned end) {
+    char *p = screen_row(screen, r);
+    char ch;
+
+    for (; start < end; start++) {
+        ch = p[start];
+
+        if (ch == SCREEN_UNICODE) {
+            fprintf(fp, "&#x%x;", screen_code(screen, r, start));
+        } else if (ch == SCREEN_WIDE_RIGHT) {
+            continue;
+        } else if (ch == '&') {
+            fputs("&amp;", fp);
+        } else if (ch == '<') {
+            fputs("&lt;", fp);
+        } else if (ch == '>') {
+            fputs("&gt;", fp);
+        } else if (((unsigned char) ch < ' ') || ((unsigned char) ch >= 0x7f)) {
+            fputc(' ', fp);
+        } else {
+            fputc(ch, fp);
+        }
+    }
+}
+
+
+void svg_write_image(char *filename, struct screen_t *screen) {
+    unsigned width = font_width();
+    unsigned height = font_height();
+    unsigned columns = screen_width(screen);
+    unsigned rows = screen_height(screen);
+    unsigned bmp_width = width * columns + PADDING_LEFT + PADDING_RIGHT;
+    unsigned bmp_height = height * rows + PADDING_TOP + PADDING_BOTTOM;
+    unsigned r, c, start, count, i, t;
+    overlay_t *overlays = NULL;
+    char *p = NULL;
+    FILE *outfile = NULL;
+
+    outfile = fopen(filename, "w");
+    assert(outfile);
+
+    fprintf(outfile, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%u\" height=\"%u\" viewBox=\"0 0 %u %u\">\n", bmp_width, bmp_height, bmp_width, bmp_height);
+    fprintf(outfile, "<rect width=\"100%%\" height=\"100%%\"");
+    svg_color(outfile, "fill", SLOT_BG);
+    fprintf(outfile, "/>\n");
+
+    fprintf(outfile, "<g font-family=\"Monaco, Menlo, Consolas, monospace\" font-size=\"%u\" xml:space=\"preserve\"", SVG_FONT_SIZE(height));
+    svg_color(outfile, "fill", SLOT_FG);
+    fprintf(outfile, ">\n");
+
+    // A run of text ends at blurred characters, leading and trailing
+    // spaces are left out.
+    for (r = 0; r < rows; r++) {
+        p = screen_row(screen, r);
+        c = 0;
+
+        while (c < columns) {
+            while ((c < columns) && ((p[c] == ' ') || (p[c] == '\x7f'))) {
+                c++;
+            }
+
+            start = c;
+            while ((c < columns) && (p[c] != '\x7f')) {
+                c++;
+            }
+
+            count = c - start;
+            while ((count > 0) && (p[start + count - 1] == ' ')) {
+                count--;
+            }
+
+            if (count) {
+                fprintf(outfile, "<text x=\"%u\" y=\"%u\" textLength=\"%u\" lengthAdjust=\"spacing\">",
+                        PADDING_LEFT + start * width, PADDING_TOP + r * height + SVG_BASELINE(height), count * width);
+                svg_text(outfile, screen, r, start, start + count);
+                fprintf(outfile, "</text>\n");
+            }
+        }
+    }
+    fprintf(outfile, "</g>\n");
+
+    // Blurred text is a solid block per run.
+    for (r = 0; r < rows; r++) {
+        p = screen_row(screen, r);
+
+        for (c = 0; c < columns; c++) {
+            if (p[c] != '\x7f') {
+                continue;
+            }
+
+            start = c;
+            while ((c < columns) && (p[c] == '\x7f')) {
+                c++;
+            }
+
+            fprintf(outfile, "<rect x=\"%u\" y=\"%u\" width=\"%u\" height=\"%u\"",
+                    PADDING_LEFT + start * width, PADDING_TOP + r * height, (c - start) * width, height);
+            svg_color(outfile, "fill", SLOT_BLUR);
+            fprintf(outfile, "/>\n");
+        }
+    }
+
+    // The outlines cover the same pixels as in the bitmap.
+    overlays = screen_overlays(screen, &count);
+    for (i = 0; i < count; i++) {
+        t = overlays[i].thickness;
+        fprintf(outfile, "<rect x=\"%g\" y=\"%g\" width=\"%u\" height=\"%u\" fill=\"none\" stroke-width=\"%u\"",
+                overlays[i].left + t / 2.0, overlays[i].top + t / 2.0,
+                overlays[i].right - overlays[i].left + 1 - t, overlays[i].bottom - overlays[i].top + 1 - t, t);
+        svg_color(outfile, "stroke", overlays[i].color);
+        fprintf(outfile, "/>\n");
+    }
+
+    fprintf(outfile, "</svg>\n");
+    fclose(outfile);
+}
@@ -0,0 +1,13 @@
+#ifndef SVG_H
+#define SVG_H
+
+#include "types.h"
+#include "screen.h"
+
+// Write the screen as an SVG drawing: the text as <text> runs and the
+// boxes and border as <rect> outlines, laid out on the same pixel grid
+// as the bitmap.  Blurred text becomes a filled <rect>, none of the
+// original characters are written.
+void svg_write_image(char *filename, struct screen_t *screen);
+
+#endif